@@ -0,0 +1,638 @@
+/*****************************************************************************
+
+                             BehaviorBenchmark.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BehaviorBenchmark.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+// Measures the cost of each of the behaviors that make up Boid::Update.
+//
+// Every behavior is timed for each flock size with the boids clustered in the 10 x 10 box used by the demo and with
+// the boids spread over the whole terrain. A benchmark calls the behavior once for every boid in the flock, and
+// repeats until it has run for at least the minimum time. The reported time is the time per call.
+//
+// The names and the JSON output follow the conventions of Google Benchmark (name/arguments, real_time, cpu_time,
+// iterations, items_per_second), so the results can be compared between builds with the same tools.
+//
+// Usage: BehaviorBenchmark [options] [flock size ...]
+//
+//	-filter <text>		Only run the benchmarks with names containing the text
+//	-min_time <seconds>	Minimum time for each benchmark (default .5)
+//	-json <file>		Write the results as JSON to the file ("-" for the standard output)
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include "Math/Vector3f.h"
+#include "Heightfield/Heightfield.h"
+
+#include "Boid.h"
+#include "BoidArrays.h"
+#include "BoidGrid.h"
+#include "Flock.h"
+#include "TerrainCache.h"
+#include "Scenario.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Calls the behaviors of a boid. The behaviors are private, and this class is a friend of Boid.
+
+class BehaviorBenchmark
+{
+public:
+
+	static Vector3f	Cruise( Boid const & boid )
+	{
+		return boid.Cruise();
+	}
+
+	static Vector3f	AvoidTerrain( Boid const & boid, HeightField const & terrain, float xyScale, float seaLevel )
+	{
+		return boid.AvoidTerrain( terrain, xyScale, seaLevel );
+	}
+
+	static bool		OverWater( Boid const & boid, HeightField const & terrain, float xyScale, float seaLevel )
+	{
+		return boid.OverWater( terrain, xyScale, seaLevel );
+	}
+
+	static Vector3f	AvoidTerrain( Boid const & boid, TerrainCache const & cache )
+	{
+		return boid.AvoidTerrain( cache );
+	}
+
+	static bool		OverWater( Boid const & boid, TerrainCache const & cache )
+	{
+		return boid.OverWater( cache );
+	}
+
+	static Vector3f	Align( Boid const & boid, BoidArrays const & boids, int closest )
+	{
+		return boid.Align( boids, closest );
+	}
+
+	static Vector3f	Congregate( Boid const & boid, BoidArrays const & boids, int closest )
+	{
+		return boid.Congregate( boids, closest );
+	}
+
+	static int		FindClosest( Boid const & boid, BoidArrays const & boids, BoidGrid const & grid )
+	{
+		return boid.FindClosest( boids, &grid, 0.f, 0.f );
+	}
+
+	static void		Wrap( Boid & boid, HeightField const & terrain, float xyScale )
+	{
+		boid.Wrap( terrain, xyScale );
+	}
+};
+
+
+namespace
+{
+
+int const	TERRAIN_SIZE	= 257;
+float const	XY_SCALE		= 1.f;
+float const	Z_SCALE			= 32.f;
+float const	SEA_LEVEL		= Z_SCALE * .25f;
+
+typedef std::chrono::steady_clock	Clock;
+
+// The world that the behaviors are timed in
+struct World
+{
+	HeightField const *		m_pTerrain;
+	Flock					m_Flock;		// Positions and velocities of the flock
+	std::vector< Boid >		m_Boids;		// The same boids as objects
+	BoidGrid				m_Grid;
+	TerrainCache			m_TerrainCache;
+	std::vector< int >		m_Closest;		// Closest boid to each boid
+	std::vector< float >	m_Heights;		// Height of the terrain below each boid
+
+	World() : m_pTerrain( 0 ), m_Flock( Flock::STORAGE_ARRAYS ) {}
+};
+
+// Call a behavior once for each boid in the world, and return something computed from the results so that the
+// calls are not optimized away
+typedef float ( *Body )( World & world );
+
+// A measured benchmark
+struct Result
+{
+	std::string	m_Name;
+	long long	m_Iterations;
+	double		m_RealTime;		// Nanoseconds per iteration
+	double		m_CpuTime;		// Nanoseconds per iteration
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float CruiseBody( World & world )
+{
+	float	sum	= 0.f;
+
+	for ( std::vector< Boid >::const_iterator pB = world.m_Boids.begin(); pB != world.m_Boids.end(); ++pB )
+	{
+		sum += BehaviorBenchmark::Cruise( *pB ).m_Z;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float AvoidTerrainBody( World & world )
+{
+	float	sum	= 0.f;
+
+	for ( std::vector< Boid >::const_iterator pB = world.m_Boids.begin(); pB != world.m_Boids.end(); ++pB )
+	{
+		sum += BehaviorBenchmark::AvoidTerrain( *pB, *world.m_pTerrain, XY_SCALE, SEA_LEVEL ).m_Z;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float OverWaterBody( World & world )
+{
+	float	sum	= 0.f;
+
+	for ( std::vector< Boid >::const_iterator pB = world.m_Boids.begin(); pB != world.m_Boids.end(); ++pB )
+	{
+		sum += BehaviorBenchmark::OverWater( *pB, *world.m_pTerrain, XY_SCALE, SEA_LEVEL ) ? 1.f : 0.f;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float AvoidTerrainCachedBody( World & world )
+{
+	float	sum	= 0.f;
+
+	for ( std::vector< Boid >::const_iterator pB = world.m_Boids.begin(); pB != world.m_Boids.end(); ++pB )
+	{
+		sum += BehaviorBenchmark::AvoidTerrain( *pB, world.m_TerrainCache ).m_Z;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float OverWaterCachedBody( World & world )
+{
+	float	sum	= 0.f;
+
+	for ( std::vector< Boid >::const_iterator pB = world.m_Boids.begin(); pB != world.m_Boids.end(); ++pB )
+	{
+		sum += BehaviorBenchmark::OverWater( *pB, world.m_TerrainCache ) ? 1.f : 0.f;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The heights are sampled for the whole flock in one call, and the time is divided among the boids
+
+float SampleHeightsBody( World & world, TerrainCache::Sampling sampling )
+{
+	BoidArrays const &	boids	= world.m_Flock.GetArrays();
+
+	world.m_TerrainCache.SampleHeights( &boids.m_X[ 0 ], &boids.m_Y[ 0 ], boids.Size(), &world.m_Heights[ 0 ], sampling );
+
+	return world.m_Heights[ 0 ];
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float SampleHeightsNearestBody( World & world )
+{
+	return SampleHeightsBody( world, TerrainCache::SAMPLE_NEAREST );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float SampleHeightsBilinearBody( World & world )
+{
+	return SampleHeightsBody( world, TerrainCache::SAMPLE_BILINEAR );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float AlignBody( World & world )
+{
+	BoidArrays const &	boids	= world.m_Flock.GetArrays();
+	float				sum		= 0.f;
+
+	for ( int i = 0; i < int( world.m_Boids.size() ); i++ )
+	{
+		sum += BehaviorBenchmark::Align( world.m_Boids[ i ], boids, world.m_Closest[ i ] ).m_X;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float CongregateBody( World & world )
+{
+	BoidArrays const &	boids	= world.m_Flock.GetArrays();
+	float				sum		= 0.f;
+
+	for ( int i = 0; i < int( world.m_Boids.size() ); i++ )
+	{
+		sum += BehaviorBenchmark::Congregate( world.m_Boids[ i ], boids, world.m_Closest[ i ] ).m_X;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float FindClosestBody( World & world )
+{
+	BoidArrays const &	boids	= world.m_Flock.GetArrays();
+	float				sum		= 0.f;
+
+	for ( std::vector< Boid >::const_iterator pB = world.m_Boids.begin(); pB != world.m_Boids.end(); ++pB )
+	{
+		sum += float( BehaviorBenchmark::FindClosest( *pB, boids, world.m_Grid ) );
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The boids are all on the terrain, so this measures the usual case, in which nothing is changed
+
+float WrapBody( World & world )
+{
+	float	sum	= 0.f;
+
+	for ( std::vector< Boid >::iterator pB = world.m_Boids.begin(); pB != world.m_Boids.end(); ++pB )
+	{
+		BehaviorBenchmark::Wrap( *pB, *world.m_pTerrain, XY_SCALE );
+		sum += pB->m_Position.m_X;
+	}
+
+	return sum;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Create the flock and everything that the behaviors need
+
+void BuildWorld( World & world, HeightField const & terrain, int n, Scenario::Distribution distribution )
+{
+	world.m_pTerrain = &terrain;
+
+	Scenario::SpawnBoids( world.m_Flock, n, distribution, terrain, XY_SCALE, 1 );
+
+	BoidArrays const &	boids	= world.m_Flock.GetArrays();
+
+	world.m_Boids.reserve( n );
+	for ( int i = 0; i < n; i++ )
+	{
+		world.m_Boids.push_back( Boid( boids.GetPosition( i ), boids.GetVelocity( i ) ) );
+	}
+
+	world.m_Grid.Build( boids,
+						( terrain.GetSizeX() - 1 ) * XY_SCALE, ( terrain.GetSizeY() - 1 ) * XY_SCALE,
+						Boid::MAX_PERCEPTION_DISTANCE, true );
+
+	world.m_TerrainCache.Refresh( terrain, XY_SCALE, SEA_LEVEL );
+	world.m_Heights.resize( n );
+
+	world.m_Closest.resize( n );
+	for ( int i = 0; i < n; i++ )
+	{
+		world.m_Closest[ i ] = BehaviorBenchmark::FindClosest( world.m_Boids[ i ], boids, world.m_Grid );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Run the body until the minimum time has passed, doubling the number of passes each time
+
+Result Measure( std::string const & name, Body body, World & world, double minTime, float & checksum )
+{
+	long long	passes	= 1;
+	double		real	= 0.;
+	double		cpu		= 0.;
+
+	body( world );	// Warm up
+
+	for ( ;; )
+	{
+		Clock::time_point const	start		= Clock::now();
+		std::clock_t const		cpuStart	= std::clock();
+
+		for ( long long p = 0; p < passes; p++ )
+		{
+			checksum += body( world );
+		}
+
+		cpu = double( std::clock() - cpuStart ) / CLOCKS_PER_SEC;
+		real = std::chrono::duration< double >( Clock::now() - start ).count();
+
+		if ( real >= minTime || passes >= ( 1LL << 40 ) )
+		{
+			break;
+		}
+
+		// Aim for a little more than the minimum time, but do not grow by more than 10x at a time
+
+		double const	scale	= ( real > 0. ) ? minTime * 1.4 / real : 10.;
+		passes = ( long long )( passes * ( scale < 2. ? 2. : scale > 10. ? 10. : scale ) );
+	}
+
+	Result	result;
+
+	result.m_Name		= name;
+	result.m_Iterations	= passes * ( long long )world.m_Boids.size();
+	result.m_RealTime	= real * 1.e9 / result.m_Iterations;
+	result.m_CpuTime	= cpu * 1.e9 / result.m_Iterations;
+
+	return result;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WriteJson( FILE * fp, std::vector< Result > const & results, char const * executable, double minTime )
+{
+	char		date[ 64 ];
+	time_t		now		= time( 0 );
+
+	strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", localtime( &now ) );
+
+	fprintf( fp, "{\n" );
+	fprintf( fp, "  \"context\": {\n" );
+	fprintf( fp, "    \"date\": \"%s\",\n", date );
+	fprintf( fp, "    \"executable\": \"%s\",\n", executable );
+	fprintf( fp, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency() );
+	fprintf( fp, "    \"min_time\": %g\n", minTime );
+	fprintf( fp, "  },\n" );
+	fprintf( fp, "  \"benchmarks\": [\n" );
+
+	for ( size_t i = 0; i < results.size(); i++ )
+	{
+		Result const &	r	= results[ i ];
+
+		fprintf( fp, "    {\n" );
+		fprintf( fp, "      \"name\": \"%s\",\n", r.m_Name.c_str() );
+		fprintf( fp, "      \"run_name\": \"%s\",\n", r.m_Name.c_str() );
+		fprintf( fp, "      \"run_type\": \"iteration\",\n" );
+		fprintf( fp, "      \"iterations\": %lld,\n", r.m_Iterations );
+		fprintf( fp, "      \"real_time\": %.4f,\n", r.m_RealTime );
+		fprintf( fp, "      \"cpu_time\": %.4f,\n", r.m_CpuTime );
+		fprintf( fp, "      \"time_unit\": \"ns\",\n" );
+		fprintf( fp, "      \"items_per_second\": %.1f\n", 1.e9 / r.m_RealTime );
+		fprintf( fp, "    }%s\n", ( i + 1 < results.size() ) ? "," : "" );
+	}
+
+	fprintf( fp, "  ]\n" );
+	fprintf( fp, "}\n" );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Usage()
+{
+	fprintf( stderr, "usage: BehaviorBenchmark [-filter text] [-min_time seconds] [-json file] [flock size ...]\n" );
+	exit( 1 );
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int main( int argc, char ** argv )
+{
+	std::string			filter;
+	double				minTime		= .5;
+	char const *		jsonFile	= 0;
+	std::vector< int >	sizes;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		char const * const	arg		= argv[ i ];
+		bool const			more	= ( i + 1 < argc );
+
+		if ( strcmp( arg, "-filter" ) == 0 && more )
+		{
+			filter = argv[ ++i ];
+		}
+		else if ( strcmp( arg, "-min_time" ) == 0 && more )
+		{
+			minTime = atof( argv[ ++i ] );
+		}
+		else if ( strcmp( arg, "-json" ) == 0 && more )
+		{
+			jsonFile = argv[ ++i ];
+		}
+		else if ( arg[ 0 ] != '-' && atoi( arg ) > 0 )
+		{
+			sizes.push_back( atoi( arg ) );
+		}
+		else
+		{
+			Usage();
+		}
+	}
+
+	if ( sizes.empty() )
+	{
+		sizes.push_back( 1000 );
+		sizes.push_back( 10000 );
+		sizes.push_back( 100000 );
+	}
+
+	struct Behavior
+	{
+		char const *	m_Name;
+		Body			m_Body;
+	};
+
+	static Behavior const	behaviors[] =
+	{
+		{ "Cruise",					CruiseBody					},
+		{ "AvoidTerrain",			AvoidTerrainBody			},
+		{ "OverWater",				OverWaterBody				},
+		{ "AvoidTerrainCached",		AvoidTerrainCachedBody		},
+		{ "OverWaterCached",		OverWaterCachedBody			},
+		{ "SampleHeights",			SampleHeightsNearestBody	},
+		{ "SampleHeightsBilinear",	SampleHeightsBilinearBody	},
+		{ "Align",					AlignBody					},
+		{ "Congregate",				CongregateBody				},
+		{ "FindClosest",			FindClosestBody				},
+		{ "Wrap",					WrapBody					},
+	};
+
+	struct Density
+	{
+		char const *			m_Name;
+		Scenario::Distribution	m_Distribution;
+	};
+
+	static Density const	densities[] =
+	{
+		{ "clustered",	Scenario::CLUSTERED	},
+		{ "uniform",	Scenario::UNIFORM	},
+	};
+
+	HeightField	terrain( TERRAIN_SIZE, TERRAIN_SIZE, XY_SCALE );
+	Scenario::GenerateTerrain( terrain, Z_SCALE );
+
+	// The console output goes to stderr if the JSON goes to stdout
+
+	FILE * const			console		= ( jsonFile && strcmp( jsonFile, "-" ) == 0 ) ? stderr : stdout;
+	std::vector< Result >	results;
+	float					checksum	= 0.f;
+
+	fprintf( console, "%-36s %14s %14s %14s\n", "Benchmark", "Time", "CPU", "Iterations" );
+	fprintf( console, "--------------------------------------------------------------------------------\n" );
+
+	for ( size_t d = 0; d < sizeof( densities ) / sizeof( densities[ 0 ] ); d++ )
+	{
+		for ( std::vector< int >::const_iterator pN = sizes.begin(); pN != sizes.end(); ++pN )
+		{
+			World *	pWorld	= 0;	// Built only if a benchmark in this world is selected
+
+			for ( size_t b = 0; b < sizeof( behaviors ) / sizeof( behaviors[ 0 ] ); b++ )
+			{
+				char	name[ 128 ];
+				sprintf( name, "%s/%s/%d", behaviors[ b ].m_Name, densities[ d ].m_Name, *pN );
+
+				if ( !filter.empty() && strstr( name, filter.c_str() ) == 0 )
+				{
+					continue;
+				}
+
+				if ( !pWorld )
+				{
+					pWorld = new World;
+					BuildWorld( *pWorld, terrain, *pN, densities[ d ].m_Distribution );
+				}
+
+				Result const	result	= Measure( name, behaviors[ b ].m_Body, *pWorld, minTime, checksum );
+
+				fprintf( console, "%-36s %11.2f ns %11.2f ns %14lld\n",
+						 result.m_Name.c_str(), result.m_RealTime, result.m_CpuTime, result.m_Iterations );
+				fflush( console );
+
+				results.push_back( result );
+			}
+
+			delete pWorld;
+		}
+	}
+
+	fprintf( console, "(checksum %g)\n", checksum );
+
+	if ( jsonFile )
+	{
+		FILE * const	fp	= ( strcmp( jsonFile, "-" ) == 0 ) ? stdout : fopen( jsonFile, "w" );
+
+		if ( !fp )
+		{
+			fprintf( stderr, "Unable to open %s\n", jsonFile );
+			return 1;
+		}
+
+		WriteJson( fp, results, argv[ 0 ], minTime );
+
+		if ( fp != stdout )
+		{
+			fclose( fp );
+		}
+	}
+
+	return 0;
+}
@@ -15,10 +15,16 @@
 
 #include <vector>
 #include <limits>
+#include <cmath>
 #include "Math/Vector3f.h"
 #include "Math/Range.h"
 #include "Heightfield/Heightfield.h"
 
+#include "BoidArrays.h"
+#include "BoidGrid.h"
+#include "TerrainCache.h"
+#include "FlockProfile.h"
+
 float const					Boid::MAX_SPEED_XY						= 20.000f;
 float const					Boid::MAX_SPEED_Z						= 10.000f;
 float const					Boid::MAX_ACCELERATION					= 5.00f;
@@ -56,16 +62,50 @@ Boid::~Boid()
 /********************************************************************************************************************/
 
 void Boid::Update( float dt,
-				   BoidList const & boids,
+				   BoidArrays const & boids,
 				   HeightField const & terrain, float xyScale,
-				   float seaLevel )
+				   float seaLevel,
+				   BoidGrid const * pGrid,
+				   TerrainCache const * pTerrainCache,
+				   float const * pTerrainHeight )
 {
+	FLOCKPROFILE_COUNT( COUNTER_BOID_UPDATES, 1 );
+
+	// The closest boid is found once and shared by the behaviors that need it. The terrain wraps, so distances are
+	// measured across its edges.
+
+	int	closest;
+
+	{
+		FLOCKPROFILE_SCOPE( TIMER_NEIGHBOR_QUERY );
+
+		closest = FindClosest( boids, pGrid, ( terrain.GetSizeX() - 1.f ) * xyScale,
+							   ( terrain.GetSizeY() - 1.f ) * xyScale );
+	}
+
 	Vector3f	acceleration	= Vector3f::ORIGIN;
 
 	acceleration += Cruise();
-	acceleration += AvoidTerrain( terrain, xyScale, seaLevel );
-	acceleration += Align( boids );
-	acceleration += Congregate( boids );
+
+	// The height below the boid may have been sampled already
+
+	if ( pTerrainHeight )
+	{
+		acceleration += AvoidTerrain( *pTerrainHeight, seaLevel );
+	}
+	else if ( pTerrainCache )
+	{
+		acceleration += AvoidTerrain( *pTerrainCache );
+		FLOCKPROFILE_COUNT( COUNTER_TERRAIN_SAMPLES, 1 );
+	}
+	else
+	{
+		acceleration += AvoidTerrain( terrain, xyScale, seaLevel );
+		FLOCKPROFILE_COUNT( COUNTER_TERRAIN_SAMPLES, 1 );
+	}
+
+	acceleration += Align( boids, closest );
+	acceleration += Congregate( boids, closest );
 
 	m_Velocity += acceleration;
 
@@ -76,8 +116,10 @@ void Boid::Update( float dt,
 	// If the boid is over water, then put him back and reverse his velocity in
 	// the XY plane and make him go back instead
 
-	if ( OverWater( terrain, xyScale, seaLevel ) )
+	if ( pTerrainCache ? OverWater( *pTerrainCache ) : OverWater( terrain, xyScale, seaLevel ) )
 	{
+		FLOCKPROFILE_COUNT( COUNTER_WATER_BOUNCES, 1 );
+
 		// Put him back
 		
 		m_Position -= m_Velocity * dt;
@@ -109,10 +151,12 @@ void Boid::Wrap( HeightField const & terrain, float xyScale )
 	if ( m_Position.m_X < -tw2 )
 	{
 		m_Position.m_X += tw;
+		FLOCKPROFILE_COUNT( COUNTER_WRAPS, 1 );
 	}
 	else if ( m_Position.m_X > tw2 )
 	{
 		m_Position.m_X -= tw;
+		FLOCKPROFILE_COUNT( COUNTER_WRAPS, 1 );
 	}
 
 	float const	th	= ( terrain.GetSizeY() - 1.f ) * xyScale;
@@ -121,10 +165,12 @@ void Boid::Wrap( HeightField const & terrain, float xyScale )
 	if ( m_Position.m_Y < -th2 )
 	{
 		m_Position.m_Y += th;
+		FLOCKPROFILE_COUNT( COUNTER_WRAPS, 1 );
 	}
 	else if ( m_Position.m_Y > th2 )
 	{
 		m_Position.m_Y -= th;
+		FLOCKPROFILE_COUNT( COUNTER_WRAPS, 1 );
 	}
 }
 
@@ -157,7 +203,45 @@ Vector3f	Boid::AvoidTerrain( HeightField const & terrain, float xyScale, float s
 {
 	int const	tx		= m_Position.m_X / xyScale + ( terrain.GetSizeX() - 1.f ) * .5f + .5f;
 	int const	ty		= m_Position.m_Y / xyScale + ( terrain.GetSizeY() - 1.f ) * .5f + .5f;
-	float const	height	= m_Position.m_Z - terrain.GetZ( tx, ty );
+
+	return AvoidTerrain( terrain.GetZ( tx, ty ), seaLevel );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool	Boid::OverWater( HeightField const & terrain, float xyScale, float seaLevel ) const
+{
+	int const	tx		= m_Position.m_X / xyScale + ( terrain.GetSizeX() - 1.f ) * .5f + .5f;
+	int const	ty		= m_Position.m_Y / xyScale + ( terrain.GetSizeY() - 1.f ) * .5f + .5f;
+	float const	depth	= seaLevel - terrain.GetZ( tx, ty );
+
+	return ( depth <= 0.f );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Vector3f	Boid::AvoidTerrain( TerrainCache const & cache ) const
+{
+	return AvoidTerrain( cache.GetHeight( cache.GetIndex( m_Position ) ), cache.GetSeaLevel() );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Vector3f	Boid::AvoidTerrain( float terrainHeight, float seaLevel ) const
+{
+	float const	height	= m_Position.m_Z - terrainHeight;
 
 	if ( height < DESIRED_HEIGHT || m_Position.m_Z <= seaLevel )
 	{
@@ -179,13 +263,9 @@ Vector3f	Boid::AvoidTerrain( HeightField const & terrain, float xyScale, float s
 /*																													*/
 /********************************************************************************************************************/
 
-bool	Boid::OverWater( HeightField const & terrain, float xyScale, float seaLevel ) const
+bool	Boid::OverWater( TerrainCache const & cache ) const
 {
-	int const	tx		= m_Position.m_X / xyScale + ( terrain.GetSizeX() - 1.f ) * .5f + .5f;
-	int const	ty		= m_Position.m_Y / xyScale + ( terrain.GetSizeY() - 1.f ) * .5f + .5f;
-	float const	depth	= seaLevel - terrain.GetZ( tx, ty );
-
-	return ( depth <= 0.f );
+	return cache.IsOverWater( cache.GetIndex( m_Position ) );
 }
 
 
@@ -194,10 +274,10 @@ bool	Boid::OverWater( HeightField const & terrain, float xyScale, float seaLevel
 /*																													*/
 /********************************************************************************************************************/
 
-Vector3f	Boid::Separate( BoidList const & boids ) const
+Vector3f	Boid::Separate( BoidArrays const & boids ) const
 {
-//	Boid const *	pClosest	= FindClosest( boids );
-//	Vector3f const	separation	= m_Position - pClosest->m_Position;
+//	int const		closest		= FindClosest( boids, 0 );
+//	Vector3f const	separation	= m_Position - boids.GetPosition( closest );
 //	float const		distance	= separation.Length();
 //
 //	if ( distance < DESIRED_SEPARATION )
@@ -217,13 +297,11 @@ Vector3f	Boid::Separate( BoidList const & boids ) const
 /*																													*/
 /********************************************************************************************************************/
 
-Vector3f	Boid::Align( BoidList const & boids ) const
+Vector3f	Boid::Align( BoidArrays const & boids, int closest ) const
 {
-	Boid const * const	pClosest	= FindClosest( boids );
-
-	if ( pClosest )
+	if ( closest >= 0 )
 	{
-		Vector3f	v	= pClosest->m_Velocity;
+		Vector3f	v	= boids.GetVelocity( closest );
 		return v.Normalize() * DESIRED_SPEED - m_Velocity;
 	}
 	else
@@ -239,18 +317,16 @@ Vector3f	Boid::Align( BoidList const & boids ) const
 /*																													*/
 /********************************************************************************************************************/
 
-Vector3f	Boid::Congregate( BoidList const & boids ) const
+Vector3f	Boid::Congregate( BoidArrays const & boids, int closest ) const
 {
-	Boid const * const	pClosest	= FindClosest( boids );
-
 	// If no boids are nearby, then no effect
 
-	if ( !pClosest )
+	if ( closest < 0 )
 	{
 		return Vector3f::ORIGIN;
 	}
 
-	Vector3f const	separation	= pClosest->m_Position - m_Position;
+	Vector3f const	separation	= boids.GetPosition( closest ) - m_Position;
 	float const		distance	= separation.Length();
 
 	if ( Math::IsCloseToZero( distance ) )
@@ -273,21 +349,55 @@ Vector3f	Boid::Congregate( BoidList const & boids ) const
 /*																													*/
 /********************************************************************************************************************/
 
-Boid const *	Boid::FindClosest( BoidList const & boids ) const
+int		Boid::FindClosest( BoidArrays const & boids, BoidGrid const * pGrid, float sizeX, float sizeY ) const
 {
-	Boid const *	pClosest		= 0;
-	float			closestDistance	= std::numeric_limits< float >::max();
+	// If there is a grid, then only the nearby boids are checked. The result is the same as searching the whole flock.
+
+	if ( pGrid )
+	{
+		FLOCKPROFILE_COUNT( COUNTER_NEIGHBOR_QUERIES, 1 );
+		return pGrid->FindClosest( m_Position, MAX_PERCEPTION_DISTANCE );
+	}
+
+	FLOCKPROFILE_COUNT( COUNTER_NEIGHBOR_QUERIES, 1 );
+	FLOCKPROFILE_COUNT( COUNTER_NEIGHBOR_CANDIDATES, boids.Size() );
+
+	// Squared distances are compared, in the same way as the grid does. The offsets to the images on the other sides
+	// are computed in the same way as well, so the results match.
+
+	float const	maxDistance2		= MAX_PERCEPTION_DISTANCE * MAX_PERCEPTION_DISTANCE;
+	int			closest				= -1;
+	float		closestDistance2	= std::numeric_limits< float >::max();
+
+	float const	lowX	= m_Position.m_X + sizeX;
+	float const	highX	= m_Position.m_X - sizeX;
+	float const	lowY	= m_Position.m_Y + sizeY;
+	float const	highY	= m_Position.m_Y - sizeY;
 
-	for ( BoidList::const_iterator ppB = boids.begin(); ppB != boids.end(); ++ppB )
+	for ( int i = 0; i < boids.Size(); i++ )
 	{
-		float const	distance	= ( m_Position - (*ppB)->m_Position ).Length();
+		float	dx	= boids.m_X[ i ] - m_Position.m_X;
+		float	dy	= boids.m_Y[ i ] - m_Position.m_Y;
 
-		if ( distance < closestDistance && distance < MAX_PERCEPTION_DISTANCE )
+		float const	dxLow	= boids.m_X[ i ] - lowX;
+		float const	dxHigh	= boids.m_X[ i ] - highX;
+		float const	dyLow	= boids.m_Y[ i ] - lowY;
+		float const	dyHigh	= boids.m_Y[ i ] - highY;
+
+		if ( fabs( dxLow ) < fabs( dx ) )	dx = dxLow;
+		if ( fabs( dxHigh ) < fabs( dx ) )	dx = dxHigh;
+		if ( fabs( dyLow ) < fabs( dy ) )	dy = dyLow;
+		if ( fabs( dyHigh ) < fabs( dy ) )	dy = dyHigh;
+
+		float const	dz			= boids.m_Z[ i ] - m_Position.m_Z;
+		float const	distance2	= ( dx * dx + dy * dy ) + dz * dz;
+
+		if ( distance2 < closestDistance2 && distance2 < maxDistance2 )
 		{
-			closestDistance = distance;
-			pClosest = *ppB;
+			closestDistance2 = distance2;
+			closest = i;
 		}
 	}
 
-	return pClosest;
-}
\ No newline at end of file
+	return closest;
+}
@@ -22,6 +22,9 @@
 #include "Math/Range.h"
 
 class HeightField;
+class BoidArrays;
+class BoidGrid;
+class TerrainCache;
 
 
 /********************************************************************************************************************/
@@ -47,10 +50,17 @@ public:
 	Boid( Vector3f const & position, Vector3f const & velocity );
 	virtual ~Boid();
 
+	// Update the boid. If a grid is given, it is used to find neighbors instead of searching the entire flock. If a
+	// terrain cache is given, it must be built from the same terrain, scale, and sea level, and it is used instead of
+	// the terrain. If the height of the terrain below the boid is given (see TerrainCache::SampleHeights), it is used
+	// to avoid the terrain.
 	void Update( float dt,
-				 BoidList const & boids,
+				 BoidArrays const & boids,
 				 HeightField const & terrain, float xyScale,
-				 float seaLevel );
+				 float seaLevel,
+				 BoidGrid const * pGrid = 0,
+				 TerrainCache const * pTerrainCache = 0,
+				 float const * pTerrainHeight = 0 );
 
 	Vector3f	m_Position;
 	Vector3f	m_Velocity;
@@ -67,8 +77,18 @@ public:
 
 private:
 
-	// Return the closest boid in the list
-	Boid const *	FindClosest( BoidList const & boids ) const;
+	// The behavior microbenchmarks time the behaviors individually
+	friend class BehaviorBenchmark;
+
+	// The query benchmark updates boids with the closest boid found once or twice
+	friend class BoidBenchmark;
+
+	// The tests compare the grid with the brute-force search
+	friend class FlockTest;
+
+	// Return the index of the closest boid in the flock, or -1 if none are within perception distance. Without a grid,
+	// distances are measured to the nearest image of each boid on a terrain of the given size, which wraps as in Wrap().
+	int			FindClosest( BoidArrays const & boids, BoidGrid const * pGrid, float sizeX, float sizeY ) const;
 
 	// Return the change in velocity for unaffected movement
 	Vector3f	Cruise() const;
@@ -79,14 +99,21 @@ private:
 	// Return the change in velocity to avoid something
 	bool		OverWater( HeightField const & terrain, float xyScale, float seaLevel ) const;
 
+	// Same as AvoidTerrain() and OverWater(), using the cached terrain
+	Vector3f	AvoidTerrain( TerrainCache const & cache ) const;
+	bool		OverWater( TerrainCache const & cache ) const;
+
+	// Same as AvoidTerrain(), given the height of the terrain below the boid
+	Vector3f	AvoidTerrain( float terrainHeight, float seaLevel ) const;
+
 	// Return the change in velocity to achieve the desired separation
-	Vector3f	Separate( BoidList const & boids ) const;
+	Vector3f	Separate( BoidArrays const & boids ) const;
 
-	// Compute the change in velocity to be aligned with nearby boids
-	Vector3f	Align( BoidList const & boids ) const;
+	// Compute the change in velocity to be aligned with the closest boid (-1 if none)
+	Vector3f	Align( BoidArrays const & boids, int closest ) const;
 
-	// Compute the change in velocity to achieve the desired closeness to nearby boids
-	Vector3f	Congregate( BoidList const & boids ) const;
+	// Compute the change in velocity to achieve the desired closeness to the closest boid (-1 if none)
+	Vector3f	Congregate( BoidArrays const & boids, int closest ) const;
 
 	void		Wrap( HeightField const & terrain, float xyScale );
 
@@ -0,0 +1,91 @@
+/*****************************************************************************
+
+                                BoidArrays.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidArrays.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "BoidArrays.h"
+
+#include <vector>
+#include "Math/Vector3f.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidArrays::Resize( int n )
+{
+	m_X.resize( n );
+	m_Y.resize( n );
+	m_Z.resize( n );
+	m_VX.resize( n );
+	m_VY.resize( n );
+	m_VZ.resize( n );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int BoidArrays::Add( Vector3f const & position, Vector3f const & velocity )
+{
+	m_X.push_back( position.m_X );
+	m_Y.push_back( position.m_Y );
+	m_Z.push_back( position.m_Z );
+	m_VX.push_back( velocity.m_X );
+	m_VY.push_back( velocity.m_Y );
+	m_VZ.push_back( velocity.m_Z );
+
+	return Size() - 1;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidArrays::Swap( BoidArrays & other )
+{
+	m_X.swap( other.m_X );
+	m_Y.swap( other.m_Y );
+	m_Z.swap( other.m_Z );
+	m_VX.swap( other.m_VX );
+	m_VY.swap( other.m_VY );
+	m_VZ.swap( other.m_VZ );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidArrays::Gather( BoidArrays const & source, std::vector< int > const & order )
+{
+	int const	n	= int( order.size() );
+
+	Resize( n );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		int const	j	= order[ i ];
+
+		m_X[ i ]	= source.m_X[ j ];
+		m_Y[ i ]	= source.m_Y[ j ];
+		m_Z[ i ]	= source.m_Z[ j ];
+		m_VX[ i ]	= source.m_VX[ j ];
+		m_VY[ i ]	= source.m_VY[ j ];
+		m_VZ[ i ]	= source.m_VZ[ j ];
+	}
+}
@@ -0,0 +1,83 @@
+#if !defined( BOIDARRAYS_H_INCLUDED )
+#define BOIDARRAYS_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                 BoidArrays.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidArrays.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include "Math/Vector3f.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The positions and velocities of a set of boids, stored as separate contiguous arrays for each component
+
+class BoidArrays
+{
+public:
+
+	// Return the number of boids
+	int			Size() const							{ return int( m_X.size() ); }
+
+	// Change the number of boids
+	void		Resize( int n );
+
+	// Remove all boids
+	void		Clear()									{ Resize( 0 ); }
+
+	// Exchange contents with another set of arrays
+	void		Swap( BoidArrays & other );
+
+	// Replace the contents with boids from another set of arrays, in the given order. Boid i is boid order[ i ] of the
+	// other set.
+	void		Gather( BoidArrays const & source, std::vector< int > const & order );
+
+	// Add a boid to the end and return its index
+	int			Add( Vector3f const & position, Vector3f const & velocity );
+
+	// Return the position of a boid
+	Vector3f	GetPosition( int i ) const				{ return Vector3f( m_X[ i ], m_Y[ i ], m_Z[ i ] ); }
+
+	// Return the velocity of a boid
+	Vector3f	GetVelocity( int i ) const				{ return Vector3f( m_VX[ i ], m_VY[ i ], m_VZ[ i ] ); }
+
+	// Set the position of a boid
+	void		SetPosition( int i, Vector3f const & position )
+	{
+		m_X[ i ] = position.m_X;
+		m_Y[ i ] = position.m_Y;
+		m_Z[ i ] = position.m_Z;
+	}
+
+	// Set the velocity of a boid
+	void		SetVelocity( int i, Vector3f const & velocity )
+	{
+		m_VX[ i ] = velocity.m_X;
+		m_VY[ i ] = velocity.m_Y;
+		m_VZ[ i ] = velocity.m_Z;
+	}
+
+	std::vector< float >	m_X;		// Positions
+	std::vector< float >	m_Y;
+	std::vector< float >	m_Z;
+	std::vector< float >	m_VX;		// Velocities
+	std::vector< float >	m_VY;
+	std::vector< float >	m_VZ;
+};
+
+
+#endif // !defined( BOIDARRAYS_H_INCLUDED )
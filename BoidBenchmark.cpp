@@ -0,0 +1,233 @@
+/*****************************************************************************
+
+                               BoidBenchmark.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidBenchmark.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+// Measures the cost of the closest-boid queries made by Boid::Update.
+//
+// Boid::Update used to search for the closest boid once in Align and again in Congregate. It now searches once and
+// shares the result. This program times a complete update of every boid with each pattern over the same grid, along
+// with a complete Flock::Update, for a range of flock sizes. Both patterns must move the boids to the same places.
+//
+// Usage: BoidBenchmark [flock size ...]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include "Math/Vector3f.h"
+#include "Heightfield/Heightfield.h"
+
+#include "Boid.h"
+#include "BoidArrays.h"
+#include "BoidGrid.h"
+#include "Flock.h"
+#include "Scenario.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Updates a boid with either pattern. The behaviors are private, and this class is a friend of Boid.
+
+class BoidBenchmark
+{
+public:
+
+	// Update the boid as Boid::Update did when Align and Congregate each searched for the closest boid
+	static void	UpdateSeparate( Boid & boid, float dt, BoidArrays const & boids,
+								HeightField const & terrain, float xyScale, float seaLevel, BoidGrid const & grid )
+	{
+		Vector3f	acceleration	= Vector3f::ORIGIN;
+
+		acceleration += boid.Cruise();
+		acceleration += boid.AvoidTerrain( terrain, xyScale, seaLevel );
+		acceleration += boid.Align( boids, boid.FindClosest( boids, &grid, 0.f, 0.f ) );
+		acceleration += boid.Congregate( boids, boid.FindClosest( boids, &grid, 0.f, 0.f ) );
+
+		boid.m_Velocity += acceleration;
+		boid.m_Position += boid.m_Velocity * dt;
+		boid.Wrap( terrain, xyScale );
+
+		if ( boid.OverWater( terrain, xyScale, seaLevel ) )
+		{
+			boid.m_Position -= boid.m_Velocity * dt;
+			boid.m_Velocity.m_X = -boid.m_Velocity.m_X;
+			boid.m_Velocity.m_Y = -boid.m_Velocity.m_Y;
+			boid.m_Position += boid.m_Velocity * dt;
+			boid.Wrap( terrain, xyScale );
+		}
+	}
+
+	// Update the boid with Boid::Update, which searches once and shares the result
+	static void	UpdateShared( Boid & boid, float dt, BoidArrays const & boids,
+							  HeightField const & terrain, float xyScale, float seaLevel, BoidGrid const & grid )
+	{
+		boid.Update( dt, boids, terrain, xyScale, seaLevel, &grid );
+	}
+};
+
+
+namespace
+{
+
+int const	TERRAIN_SIZE	= 257;
+float const	XY_SCALE		= 1.f;
+float const	Z_SCALE			= 32.f;
+float const	SEA_LEVEL		= Z_SCALE * .25f;
+float const	DT				= 1.f / 60.f;
+int const	REPETITIONS		= 5;
+
+typedef std::chrono::steady_clock	Clock;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+double Seconds( Clock::time_point start, Clock::time_point end )
+{
+	return std::chrono::duration< double >( end - start ).count();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+typedef void ( *UpdateFunction )( Boid & boid, float dt, BoidArrays const & boids,
+								  HeightField const & terrain, float xyScale, float seaLevel, BoidGrid const & grid );
+
+// Return the time per boid to update every boid with the given function. The boids are updated from the same state
+// each time, and the sum of their new positions is returned in sum.
+
+double TimeBoidUpdates( UpdateFunction update, BoidArrays const & boids, BoidGrid const & grid,
+						HeightField const & terrain, Vector3f & sum )
+{
+	double	best	= 1.e30;
+
+	for ( int r = 0; r < REPETITIONS; r++ )
+	{
+		Clock::time_point const	start	= Clock::now();
+
+		sum = Vector3f::ORIGIN;
+
+		for ( int i = 0; i < boids.Size(); i++ )
+		{
+			Boid	boid( boids.GetPosition( i ), boids.GetVelocity( i ) );
+
+			update( boid, DT, boids, terrain, XY_SCALE, SEA_LEVEL, grid );
+
+			sum += boid.m_Position;
+		}
+
+		double const	elapsed	= Seconds( start, Clock::now() );
+
+		if ( elapsed < best )
+		{
+			best = elapsed;
+		}
+	}
+
+	return best / boids.Size();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Return the time per boid of a complete update
+
+double TimeUpdate( Flock & flock, HeightField const & terrain )
+{
+	double	best	= 1.e30;
+
+	for ( int r = 0; r < REPETITIONS; r++ )
+	{
+		Clock::time_point const	start	= Clock::now();
+
+		flock.Update( DT, terrain, XY_SCALE, SEA_LEVEL );
+
+		double const	elapsed	= Seconds( start, Clock::now() );
+
+		if ( elapsed < best )
+		{
+			best = elapsed;
+		}
+	}
+
+	return best / flock.GetCount();
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int main( int argc, char ** argv )
+{
+	std::vector< int >	sizes;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		sizes.push_back( atoi( argv[ i ] ) );
+	}
+
+	if ( sizes.empty() )
+	{
+		sizes.push_back( 1000 );
+		sizes.push_back( 10000 );
+		sizes.push_back( 100000 );
+	}
+
+	HeightField	terrain( TERRAIN_SIZE, TERRAIN_SIZE, XY_SCALE );
+	Scenario::GenerateTerrain( terrain, Z_SCALE );
+
+	bool	same	= true;
+
+	printf( "%10s %16s %16s %8s %16s\n", "boids", "separate ns", "shared ns", "ratio", "flock update ns" );
+
+	for ( std::vector< int >::const_iterator pN = sizes.begin(); pN != sizes.end(); ++pN )
+	{
+		Flock	flock( Flock::STORAGE_ARRAYS );
+		Scenario::SpawnBoids( flock, *pN, Scenario::UNIFORM, terrain, XY_SCALE, 1 );
+
+		BoidGrid	grid;
+		grid.Build( flock.GetArrays(),
+					( TERRAIN_SIZE - 1 ) * XY_SCALE, ( TERRAIN_SIZE - 1 ) * XY_SCALE,
+					Boid::MAX_PERCEPTION_DISTANCE, true );
+
+		Vector3f		twiceSum;
+		Vector3f		onceSum;
+		double const	twice	= TimeBoidUpdates( BoidBenchmark::UpdateSeparate, flock.GetArrays(), grid, terrain,
+												   twiceSum );
+		double const	once	= TimeBoidUpdates( BoidBenchmark::UpdateShared, flock.GetArrays(), grid, terrain,
+												   onceSum );
+		double const	update	= TimeUpdate( flock, terrain );
+
+		printf( "%10d %16.1f %16.1f %8.2f %16.1f\n", *pN, twice * 1.e9, once * 1.e9, twice / once, update * 1.e9 );
+
+		if ( twiceSum.m_X != onceSum.m_X || twiceSum.m_Y != onceSum.m_Y || twiceSum.m_Z != onceSum.m_Z )
+		{
+			printf( "The patterns moved the boids to different places\n" );
+			same = false;
+		}
+	}
+
+	return same ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************
+
+                                BoidCulling.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidCulling.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "BoidCulling.h"
+
+#include "Math/Vector3f.h"
+#include "BoidArrays.h"
+#include "Flock.h"
+#include "Frustum.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidCulling::Cull( Flock & flock, BoidArrays const & positions, Frustum const & frustum,
+						float radius, float margin, std::vector< int > & visible )
+{
+	visible.clear();
+
+	// The boids in the cells that are not culled are checked one at a time, and the visible ones are moved to the front
+
+	int const	count	= flock.FindInFrustum( frustum, radius + margin, visible );
+	int			kept	= 0;
+
+	for ( int i = 0; i < count; i++ )
+	{
+		int const	id	= visible[ i ];
+
+		if ( !frustum.IsOutside( positions.GetPosition( id ), radius ) )
+		{
+			visible[ kept++ ] = id;
+		}
+	}
+
+	visible.resize( kept );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidCulling::CullEach( BoidArrays const & positions, Frustum const & frustum, float radius,
+							std::vector< int > & visible )
+{
+	visible.clear();
+
+	for ( int i = 0; i < positions.Size(); i++ )
+	{
+		if ( !frustum.IsOutside( positions.GetPosition( i ), radius ) )
+		{
+			visible.push_back( i );
+		}
+	}
+}
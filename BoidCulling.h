@@ -0,0 +1,50 @@
+#if !defined( BOIDCULLING_H_INCLUDED )
+#define BOIDCULLING_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                 BoidCulling.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidCulling.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+
+class BoidArrays;
+class Flock;
+class Frustum;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Finds the boids that can be seen, so that only those are drawn.
+//
+// Each boid is a sphere of the given radius around its position. The boids are first culled a cell of the flock's grid
+// at a time, and then the boids in the remaining cells are checked one by one. The positions that are checked do not
+// have to be the ones in the flock (they can be positions interpolated for drawing, for example), but the grid knows
+// only the flock's positions, so margin must be at least as far as any boid is from its position in the flock.
+
+namespace BoidCulling
+{
+
+// Store the IDs of the visible boids, in no particular order. The positions are indexed by ID.
+void	Cull( Flock & flock, BoidArrays const & positions, Frustum const & frustum, float radius, float margin,
+			  std::vector< int > & visible );
+
+// Store the IDs of the visible boids, in ID order, by checking every boid. This gives the same boids as Cull().
+void	CullEach( BoidArrays const & positions, Frustum const & frustum, float radius, std::vector< int > & visible );
+
+} // namespace BoidCulling
+
+
+#endif // !defined( BOIDCULLING_H_INCLUDED )
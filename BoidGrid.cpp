@@ -0,0 +1,664 @@
+/*****************************************************************************
+
+                                 BoidGrid.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidGrid.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "BoidGrid.h"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "Math/Vector3f.h"
+
+#include "BoidArrays.h"
+#include "Frustum.h"
+#include "NeighborKernel.h"
+#include "NeighborList.h"
+#include "FlockProfile.h"
+
+namespace
+{
+
+// Position stored in an abandoned slot. It is never within the search distance of anything.
+float const	FAR_AWAY	= std::numeric_limits< float >::max();
+
+// Neighbor ordering used by FindNearest: by distance, then by index
+
+inline bool IsCloser( NeighborList::Neighbor const & a, NeighborList::Neighbor const & b )
+{
+	return a.m_Distance2 < b.m_Distance2 || ( a.m_Distance2 == b.m_Distance2 && a.m_Index < b.m_Index );
+}
+
+// Add a neighbor to a max-heap holding the k closest neighbors found so far
+
+inline void KeepNearest( NeighborList::Neighbor * heap, int & size, int k, int index, float distance2 )
+{
+	NeighborList::Neighbor	candidate;
+	candidate.m_Index		= index;
+	candidate.m_Distance2	= distance2;
+
+	if ( size < k )
+	{
+		heap[ size++ ] = candidate;
+		std::push_heap( heap, heap + size, IsCloser );
+	}
+	else if ( IsCloser( candidate, heap[ 0 ] ) )
+	{
+		std::pop_heap( heap, heap + size, IsCloser );
+		heap[ size - 1 ] = candidate;
+		std::push_heap( heap, heap + size, IsCloser );
+	}
+}
+
+// Cells are made slightly larger than requested so that round-off can never put two boids that are within the search
+// distance into cells that are not adjacent.
+float const	CELL_SLACK	= 1.001f;
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+BoidGrid::BoidGrid()
+	: m_CellsX( 1 ), m_CellsY( 1 ),
+	m_OriginX( 0.f ), m_OriginY( 0.f ),
+	m_InvCellSizeX( 0.f ), m_InvCellSizeY( 0.f ),
+	m_SizeX( 0.f ), m_SizeY( 0.f ),
+	m_CellSize( 0.f ),
+	m_Wrap( false ),
+	m_IsBuilt( false ),
+	m_CellChangeCount( 0 ),
+	m_DisplacedCount( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+BoidGrid::~BoidGrid()
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidGrid::Build( BoidArrays const & boids, float sizeX, float sizeY, float cellSize, bool wrap )
+{
+	// Fit a whole number of cells into the area. The cells are stretched so that they are never smaller than cellSize.
+
+	m_CellsX		= std::max( int( sizeX / ( cellSize * CELL_SLACK ) ), 1 );
+	m_CellsY		= std::max( int( sizeY / ( cellSize * CELL_SLACK ) ), 1 );
+	m_OriginX		= -sizeX * .5f;
+	m_OriginY		= -sizeY * .5f;
+	m_InvCellSizeX	= ( sizeX > 0.f ) ? m_CellsX / sizeX : 0.f;
+	m_InvCellSizeY	= ( sizeY > 0.f ) ? m_CellsY / sizeY : 0.f;
+	m_SizeX			= sizeX;
+	m_SizeY			= sizeY;
+	m_CellSize		= cellSize;
+	m_Wrap			= wrap;
+	m_IsBuilt		= true;
+
+	m_CellChangeCount	= 0;
+	m_DisplacedCount	= 0;
+
+	int const	nCells	= m_CellsX * m_CellsY;
+	int const	nBoids	= boids.Size();
+
+	m_CellStart.assign( nCells + 1, 0 );
+	m_CellMin.assign( nCells, Vector3f( FAR_AWAY, FAR_AWAY, FAR_AWAY ) );
+	m_CellMax.assign( nCells, Vector3f( -FAR_AWAY, -FAR_AWAY, -FAR_AWAY ) );
+	m_X.resize( nBoids );
+	m_Y.resize( nBoids );
+	m_Z.resize( nBoids );
+	m_Id.resize( nBoids );
+	m_Cell.resize( nBoids );
+	m_Slot.resize( nBoids );
+
+	m_MovedHead.assign( nCells, -1 );
+	m_MovedNext.assign( nBoids, -1 );
+	m_MovedPrev.assign( nBoids, -1 );
+	m_MovedPosition.resize( nBoids );
+
+	// Count the boids in each cell
+
+	for ( int i = 0; i < nBoids; i++ )
+	{
+		int const	cell	= CellOf( boids.m_X[ i ], boids.m_Y[ i ] );
+
+		m_Cell[ i ] = cell;
+		++m_CellStart[ cell + 1 ];
+	}
+
+	for ( int c = 0; c < nCells; c++ )
+	{
+		m_CellStart[ c + 1 ] += m_CellStart[ c ];
+	}
+
+	// Copy the boids into their cells. The boids in each cell remain in index order.
+
+	m_NextSlot.assign( m_CellStart.begin(), m_CellStart.end() - 1 );
+
+	for ( int i = 0; i < nBoids; i++ )
+	{
+		int const	slot	= m_NextSlot[ m_Cell[ i ] ]++;
+
+		m_X[ slot ]		= boids.m_X[ i ];
+		m_Y[ slot ]		= boids.m_Y[ i ];
+		m_Z[ slot ]		= boids.m_Z[ i ];
+		m_Id[ slot ]	= i;
+		m_Slot[ i ]		= slot;
+
+		GrowBounds( m_Cell[ i ], boids.m_X[ i ], boids.m_Y[ i ], boids.m_Z[ i ] );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidGrid::Move( int index, Vector3f const & position )
+{
+	int const	oldCell	= m_Cell[ index ];
+	int const	newCell	= CellOf( position.m_X, position.m_Y );
+	int const	slot	= m_Slot[ index ];
+
+	GrowBounds( newCell, position.m_X, position.m_Y, position.m_Z );
+
+	// If the boid is still in its original cell, then just update its slot
+
+	if ( slot >= 0 && newCell == oldCell )
+	{
+		m_X[ slot ] = position.m_X;
+		m_Y[ slot ] = position.m_Y;
+		m_Z[ slot ] = position.m_Z;
+		return;
+	}
+
+	m_MovedPosition[ index ] = position;
+
+	if ( newCell == oldCell )
+	{
+		return;
+	}
+
+	++m_CellChangeCount;
+
+	// Take the boid out of its old cell
+
+	if ( slot >= 0 )
+	{
+		m_X[ slot ] = FAR_AWAY;
+		m_Y[ slot ] = FAR_AWAY;
+		m_Z[ slot ] = FAR_AWAY;
+		m_Slot[ index ] = -1;
+		++m_DisplacedCount;
+	}
+	else
+	{
+		int const	prev	= m_MovedPrev[ index ];
+		int const	next	= m_MovedNext[ index ];
+
+		if ( prev >= 0 )
+		{
+			m_MovedNext[ prev ] = next;
+		}
+		else
+		{
+			m_MovedHead[ oldCell ] = next;
+		}
+
+		if ( next >= 0 )
+		{
+			m_MovedPrev[ next ] = prev;
+		}
+	}
+
+	// Put it in the new cell's list of moved boids
+
+	int const	head	= m_MovedHead[ newCell ];
+
+	m_MovedPrev[ index ]	= -1;
+	m_MovedNext[ index ]	= head;
+	if ( head >= 0 )
+	{
+		m_MovedPrev[ head ] = index;
+	}
+	m_MovedHead[ newCell ]	= index;
+	m_Cell[ index ]			= newCell;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool BoidGrid::IsBuiltFor( int nBoids, float sizeX, float sizeY, float cellSize, bool wrap ) const
+{
+	return m_IsBuilt &&
+		   nBoids == int( m_Cell.size() ) &&
+		   sizeX == m_SizeX &&
+		   sizeY == m_SizeY &&
+		   cellSize == m_CellSize &&
+		   wrap == m_Wrap;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int BoidGrid::FindClosest( Vector3f const & position, float maxDistance ) const
+{
+	float	closestDistance2	= maxDistance * maxDistance;
+	int		closest				= -1;
+
+	Span	xSpans[ 3 ];
+	Span	ySpans[ 3 ];
+	int		nxSpans;
+	int		nySpans;
+
+	GetSpans( position, maxDistance, xSpans, nxSpans, ySpans, nySpans );
+
+	for ( int j = 0; j < nySpans; j++ )
+	{
+		float const	py	= position.m_Y - ySpans[ j ].m_Offset;
+
+		for ( int y = ySpans[ j ].m_First; y <= ySpans[ j ].m_Last; y++ )
+		{
+			for ( int i = 0; i < nxSpans; i++ )
+			{
+				FindClosestInRun( y, xSpans[ i ].m_First, xSpans[ i ].m_Last,
+								  position.m_X - xSpans[ i ].m_Offset, py, position.m_Z,
+								  closestDistance2, closest );
+			}
+		}
+	}
+
+	return closest;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int BoidGrid::FindNearest( Vector3f const & position, float maxDistance, int k, NeighborList & neighbors ) const
+{
+	int	size	= 0;
+
+	k = std::min( k, neighbors.GetCapacity() );
+	neighbors.Clear();
+
+	if ( k <= 0 )
+	{
+		return 0;
+	}
+
+	// The list is kept as a max-heap of the k closest so far, so the farthest of them is always at the front
+
+	NeighborList::Neighbor * const	heap	= &neighbors.m_Neighbors[ 0 ];
+
+	Span	xSpans[ 3 ];
+	Span	ySpans[ 3 ];
+	int		nxSpans;
+	int		nySpans;
+
+	GetSpans( position, maxDistance, xSpans, nxSpans, ySpans, nySpans );
+
+	for ( int j = 0; j < nySpans; j++ )
+	{
+		float const	py	= position.m_Y - ySpans[ j ].m_Offset;
+
+		for ( int y = ySpans[ j ].m_First; y <= ySpans[ j ].m_Last; y++ )
+		{
+			for ( int i = 0; i < nxSpans; i++ )
+			{
+				FindNearestInRun( y, xSpans[ i ].m_First, xSpans[ i ].m_Last,
+								  position.m_X - xSpans[ i ].m_Offset, py, position.m_Z,
+								  maxDistance * maxDistance, k, heap, size );
+			}
+		}
+	}
+
+	std::sort_heap( heap, heap + size, IsCloser );
+	neighbors.m_Size = size;
+
+	return size;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int BoidGrid::FindWithin( Vector3f const & position, float radius, NeighborList & neighbors ) const
+{
+	int	count	= 0;
+
+	Span	xSpans[ 3 ];
+	Span	ySpans[ 3 ];
+	int		nxSpans;
+	int		nySpans;
+
+	GetSpans( position, radius, xSpans, nxSpans, ySpans, nySpans );
+
+	for ( int j = 0; j < nySpans; j++ )
+	{
+		float const	py	= position.m_Y - ySpans[ j ].m_Offset;
+
+		for ( int y = ySpans[ j ].m_First; y <= ySpans[ j ].m_Last; y++ )
+		{
+			for ( int i = 0; i < nxSpans; i++ )
+			{
+				FindWithinInRun( y, xSpans[ i ].m_First, xSpans[ i ].m_Last,
+								 position.m_X - xSpans[ i ].m_Offset, py, position.m_Z,
+								 radius * radius, neighbors, count );
+			}
+		}
+	}
+
+	neighbors.m_Size = std::min( count, neighbors.GetCapacity() );
+
+	return count;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int BoidGrid::FindInFrustum( Frustum const & frustum, float margin, std::vector< int > & indexes ) const
+{
+	int const	nCells	= m_CellsX * m_CellsY;
+	int const	before	= int( indexes.size() );
+
+	for ( int c = 0; c < nCells; c++ )
+	{
+		int const	begin	= m_CellStart[ c ];
+		int const	end		= m_CellStart[ c + 1 ];
+
+		if ( ( begin == end && m_MovedHead[ c ] < 0 ) || frustum.IsOutside( m_CellMin[ c ], m_CellMax[ c ], margin ) )
+		{
+			continue;
+		}
+
+		// Abandoned slots still hold the indexes of their boids, which are found in the lists of moved boids instead
+
+		for ( int s = begin; s < end; s++ )
+		{
+			if ( m_Slot[ m_Id[ s ] ] == s )
+			{
+				indexes.push_back( m_Id[ s ] );
+			}
+		}
+
+		for ( int id = m_MovedHead[ c ]; id >= 0; id = m_MovedNext[ id ] )
+		{
+			indexes.push_back( id );
+		}
+	}
+
+	return int( indexes.size() ) - before;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidGrid::FindClosestInRun( int y, int x0, int x1, float px, float py, float pz,
+								 float & closestDistance2, int & closest ) const
+{
+	// Boids that have been in these cells since the grid was built. The cells in a row are adjacent in the arrays, so
+	// they are searched together.
+
+	int const	begin	= m_CellStart[ y * m_CellsX + x0 ];
+	int const	end		= m_CellStart[ y * m_CellsX + x1 + 1 ];
+
+	NeighborKernel::FindClosest( &m_X[ 0 ] + begin, &m_Y[ 0 ] + begin, &m_Z[ 0 ] + begin, &m_Id[ 0 ] + begin,
+								 end - begin,
+								 px, py, pz,
+								 closestDistance2, closest );
+
+	FLOCKPROFILE_COUNT( COUNTER_NEIGHBOR_CANDIDATES, end - begin );
+
+	// Boids that have moved into these cells since then
+
+	for ( int x = x0; x <= x1; x++ )
+	{
+		for ( int id = m_MovedHead[ y * m_CellsX + x ]; id >= 0; id = m_MovedNext[ id ] )
+		{
+			Vector3f const &	p		= m_MovedPosition[ id ];
+			float const			dx		= p.m_X - px;
+			float const			dy		= p.m_Y - py;
+			float const			dz		= p.m_Z - pz;
+			float const			d2		= ( dx * dx + dy * dy ) + dz * dz;
+
+			if ( d2 < closestDistance2 || ( d2 == closestDistance2 && id < closest ) )
+			{
+				closestDistance2 = d2;
+				closest = id;
+			}
+
+			FLOCKPROFILE_COUNT( COUNTER_NEIGHBOR_CANDIDATES, 1 );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidGrid::FindNearestInRun( int y, int x0, int x1, float px, float py, float pz, float maxDistance2, int k,
+								 NeighborList::Neighbor * heap, int & size ) const
+{
+	int const	begin	= m_CellStart[ y * m_CellsX + x0 ];
+	int const	end		= m_CellStart[ y * m_CellsX + x1 + 1 ];
+
+	for ( int s = begin; s < end; s++ )
+	{
+		float const	dx	= m_X[ s ] - px;
+		float const	dy	= m_Y[ s ] - py;
+		float const	dz	= m_Z[ s ] - pz;
+		float const	d2	= ( dx * dx + dy * dy ) + dz * dz;
+
+		if ( d2 < maxDistance2 )
+		{
+			KeepNearest( heap, size, k, m_Id[ s ], d2 );
+		}
+	}
+
+	for ( int x = x0; x <= x1; x++ )
+	{
+		for ( int id = m_MovedHead[ y * m_CellsX + x ]; id >= 0; id = m_MovedNext[ id ] )
+		{
+			Vector3f const &	p	= m_MovedPosition[ id ];
+			float const			dx	= p.m_X - px;
+			float const			dy	= p.m_Y - py;
+			float const			dz	= p.m_Z - pz;
+			float const			d2	= ( dx * dx + dy * dy ) + dz * dz;
+
+			if ( d2 < maxDistance2 )
+			{
+				KeepNearest( heap, size, k, id, d2 );
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidGrid::FindWithinInRun( int y, int x0, int x1, float px, float py, float pz, float radius2,
+								NeighborList & neighbors, int & count ) const
+{
+	int const	capacity	= neighbors.GetCapacity();
+	int const	begin		= m_CellStart[ y * m_CellsX + x0 ];
+	int const	end			= m_CellStart[ y * m_CellsX + x1 + 1 ];
+
+	for ( int s = begin; s < end; s++ )
+	{
+		float const	dx	= m_X[ s ] - px;
+		float const	dy	= m_Y[ s ] - py;
+		float const	dz	= m_Z[ s ] - pz;
+		float const	d2	= ( dx * dx + dy * dy ) + dz * dz;
+
+		if ( d2 < radius2 )
+		{
+			if ( count < capacity )
+			{
+				neighbors.m_Neighbors[ count ].m_Index		= m_Id[ s ];
+				neighbors.m_Neighbors[ count ].m_Distance2	= d2;
+			}
+			++count;
+		}
+	}
+
+	for ( int x = x0; x <= x1; x++ )
+	{
+		for ( int id = m_MovedHead[ y * m_CellsX + x ]; id >= 0; id = m_MovedNext[ id ] )
+		{
+			Vector3f const &	p	= m_MovedPosition[ id ];
+			float const			dx	= p.m_X - px;
+			float const			dy	= p.m_Y - py;
+			float const			dz	= p.m_Z - pz;
+			float const			d2	= ( dx * dx + dy * dy ) + dz * dz;
+
+			if ( d2 < radius2 )
+			{
+				if ( count < capacity )
+				{
+					neighbors.m_Neighbors[ count ].m_Index		= id;
+					neighbors.m_Neighbors[ count ].m_Distance2	= d2;
+				}
+				++count;
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int BoidGrid::CellOf( float x, float y ) const
+{
+	// Positions outside of the grid are clamped to the edge cells. Clamping never separates two cells that were
+	// adjacent, so queries remain correct.
+
+	int const	cx	= std::min( std::max( int( ( x - m_OriginX ) * m_InvCellSizeX ), 0 ), m_CellsX - 1 );
+	int const	cy	= std::min( std::max( int( ( y - m_OriginY ) * m_InvCellSizeY ), 0 ), m_CellsY - 1 );
+
+	return cy * m_CellsX + cx;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidGrid::GetSpans( Vector3f const & position, float distance,
+						 Span * xSpans, int & nxSpans, Span * ySpans, int & nySpans ) const
+{
+	// Two positions closer than the distance can be no more than this many cells apart
+
+	int const	rx		= int( distance * m_InvCellSizeX ) + 1;
+	int const	ry		= int( distance * m_InvCellSizeY ) + 1;
+
+	int const	cell	= CellOf( position.m_X, position.m_Y );
+	int const	cx		= cell % m_CellsX;
+	int const	cy		= cell / m_CellsX;
+
+	nxSpans = SplitSpan( cx - rx, cx + rx, m_CellsX, m_SizeX, m_Wrap, xSpans );
+	nySpans = SplitSpan( cy - ry, cy + ry, m_CellsY, m_SizeY, m_Wrap, ySpans );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int BoidGrid::SplitSpan( int first, int last, int nCells, float size, bool wrap, Span * spans )
+{
+	if ( !wrap )
+	{
+		spans[ 0 ].m_First	= std::max( first, 0 );
+		spans[ 0 ].m_Last	= std::min( last, nCells - 1 );
+		spans[ 0 ].m_Offset	= 0.f;
+		return 1;
+	}
+
+	// If the range covers the whole axis, then each cell is visited once, with the ones farther than half way around
+	// on the other side. A boid's image is then chosen by its cell, so when the distance is this large compared to
+	// the area, the image found might not be the nearest one.
+
+	if ( last - first + 1 >= nCells )
+	{
+		first = ( first + last ) / 2 - nCells / 2;
+		last = first + nCells - 1;
+	}
+
+	int	n	= 0;
+
+	// Cells past the low edge are the cells at the high edge, and their boids are seen a whole size lower
+
+	if ( first < 0 )
+	{
+		spans[ n ].m_First	= first + nCells;
+		spans[ n ].m_Last	= nCells - 1;
+		spans[ n ].m_Offset	= -size;
+		++n;
+
+		first = 0;
+	}
+
+	spans[ n ].m_First	= first;
+	spans[ n ].m_Last	= std::min( last, nCells - 1 );
+	spans[ n ].m_Offset	= 0.f;
+	++n;
+
+	// Cells past the high edge are the cells at the low edge, and their boids are seen a whole size higher
+
+	if ( last > nCells - 1 )
+	{
+		spans[ n ].m_First	= 0;
+		spans[ n ].m_Last	= last - nCells;
+		spans[ n ].m_Offset	= size;
+		++n;
+	}
+
+	return n;
+}
@@ -0,0 +1,173 @@
+#if !defined( BOIDGRID_H_INCLUDED )
+#define BOIDGRID_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                  BoidGrid.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidGrid.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include "Math/Vector3f.h"
+#include "NeighborList.h"
+
+class BoidArrays;
+class Frustum;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// A uniform grid of cells in the XY plane used to find the neighbors of a boid without visiting the entire flock.
+//
+// The grid covers an area centered on the origin. Boids outside of the area are placed in the nearest edge cell.
+// Cells are at least as large as the search distance, so a query only visits the cell containing the position and
+// the cells adjacent to it.
+//
+// If the grid wraps, the area is treated as a torus, as Boid::Wrap treats the terrain, and the distance to a boid is the
+// distance to its nearest image. When a query reaches past an edge of the grid, the cells on the opposite side are
+// searched as if they were just past the edge, with the query position moved by the size of the area. The cells act as
+// ghost cells without being copied, and no per-boid wrapping is needed. The image found for each boid is the nearest
+// one as long as the area is more than 2 * distance / cell size + 1 cells across.
+//
+// The boids in each cell are stored contiguously. When a boid moves to a different cell between rebuilds, its slot is
+// abandoned and it is linked into a list of moved boids belonging to its new cell. This keeps the results exact while
+// boids are updated in place, and the grid can be kept up to date this way over many updates. Queries slow down as
+// more boids leave their slots, so the grid should be rebuilt from time to time.
+//
+// The grid also keeps a box around the boids in each cell, so that whole cells can be culled. A box grows when a
+// boid moves out of it and is only made tight again when the grid is rebuilt.
+
+class BoidGrid
+{
+public:
+
+	BoidGrid();
+	virtual ~BoidGrid();
+
+	// Rebuild the grid from the positions of the boids. If wrap is true, distances are measured across the edges.
+	void	Build( BoidArrays const & boids, float sizeX, float sizeY, float cellSize, bool wrap = false );
+
+	// Update the grid after the boid at the given index has moved
+	void	Move( int index, Vector3f const & position );
+
+	// Forget the boids, so that the grid must be built again (for example, after the boids have been reordered)
+	void	Invalidate()								{ m_IsBuilt = false; }
+
+	// Return true if the grid was built with the given parameters and number of boids, so that it can be kept up to
+	// date with Move() instead of being rebuilt
+	bool	IsBuiltFor( int nBoids, float sizeX, float sizeY, float cellSize, bool wrap ) const;
+
+	// Return the number of times a boid has changed cells in Move() since the grid was built or the count was reset
+	int		GetCellChangeCount() const					{ return m_CellChangeCount; }
+
+	// Reset the number returned by GetCellChangeCount()
+	void	ResetCellChangeCount()						{ m_CellChangeCount = 0; }
+
+	// Return the number of boids that are no longer in their slots since the grid was built. Queries slow down as the
+	// number grows, and rebuilding the grid puts them back.
+	int		GetDisplacedCount() const					{ return m_DisplacedCount; }
+
+	// Return the index of the closest boid within the given distance, or -1 if there is none. Ties go to the lowest index.
+	int		FindClosest( Vector3f const & position, float maxDistance ) const;
+
+	// Find the k closest boids within the given distance and return the number found. The neighbors are sorted by
+	// distance (ties go to the lowest index). k is limited to the capacity of the list.
+	int		FindNearest( Vector3f const & position, float maxDistance, int k, NeighborList & neighbors ) const;
+
+	// Find the boids within the given distance, in no particular order, and return the number found. If the number
+	// is more than the capacity of the list, then only the first ones found are stored.
+	int		FindWithin( Vector3f const & position, float radius, NeighborList & neighbors ) const;
+
+	// Append the indexes of the boids in the cells whose boxes, grown by margin, are not entirely outside of the
+	// frustum, and return the number appended. Every boid within margin of the frustum is found, and others may be.
+	int		FindInFrustum( Frustum const & frustum, float margin, std::vector< int > & indexes ) const;
+
+private:
+
+	// A run of adjacent cells along one axis, and the offset of the images of the boids in them
+	struct Span
+	{
+		int		m_First;
+		int		m_Last;
+		float	m_Offset;
+	};
+
+	// Return the cell containing the given position
+	int		CellOf( float x, float y ) const;
+
+	// Grow the box around the boids in a cell to contain the position
+	void	GrowBounds( int cell, float x, float y, float z )
+	{
+		Vector3f &	minimum	= m_CellMin[ cell ];
+		Vector3f &	maximum	= m_CellMax[ cell ];
+
+		if ( x < minimum.m_X ) minimum.m_X = x;
+		if ( y < minimum.m_Y ) minimum.m_Y = y;
+		if ( z < minimum.m_Z ) minimum.m_Z = z;
+		if ( x > maximum.m_X ) maximum.m_X = x;
+		if ( y > maximum.m_Y ) maximum.m_Y = y;
+		if ( z > maximum.m_Z ) maximum.m_Z = z;
+	}
+
+	// Find the runs of cells that might contain boids within the given distance of the position. There are up to 3
+	// spans along each axis.
+	void	GetSpans( Vector3f const & position, float distance,
+					  Span * xSpans, int & nxSpans, Span * ySpans, int & nySpans ) const;
+
+	// Divide the cells first through last along an axis into spans of cells in the grid. Without wrapping, the cells
+	// are clamped to the grid. Returns the number of spans.
+	static int	SplitSpan( int first, int last, int nCells, float size, bool wrap, Span * spans );
+
+	// Search the cells x0 through x1 in row y for a position (already moved by the offsets of the spans)
+	void	FindClosestInRun( int y, int x0, int x1, float px, float py, float pz,
+							  float & closestDistance2, int & closest ) const;
+	void	FindNearestInRun( int y, int x0, int x1, float px, float py, float pz, float maxDistance2, int k,
+							  NeighborList::Neighbor * heap, int & size ) const;
+	void	FindWithinInRun( int y, int x0, int x1, float px, float py, float pz, float radius2,
+							 NeighborList & neighbors, int & count ) const;
+
+	int						m_CellsX;		// Number of cells in X
+	int						m_CellsY;		// Number of cells in Y
+	float					m_OriginX;		// X coordinate of the grid's minimum corner
+	float					m_OriginY;		// Y coordinate of the grid's minimum corner
+	float					m_InvCellSizeX;	// 1 / cell size in X
+	float					m_InvCellSizeY;	// 1 / cell size in Y
+	float					m_SizeX;		// Size of the area in X
+	float					m_SizeY;		// Size of the area in Y
+	float					m_CellSize;		// Minimum size of a cell, as given to Build()
+	bool					m_Wrap;			// True if distances are measured across the edges
+	bool					m_IsBuilt;		// True if Build() has been called
+	int						m_CellChangeCount;	// Number of times a boid has changed cells
+	int						m_DisplacedCount;	// Number of boids that have left their slots
+
+	std::vector< int >		m_CellStart;	// Index of the first slot of each cell (one extra at the end)
+	std::vector< int >		m_NextSlot;		// Next slot to fill in each cell (Build() only, kept to avoid reallocating)
+	std::vector< Vector3f >	m_CellMin;		// Minimum corner of the box around the boids in each cell
+	std::vector< Vector3f >	m_CellMax;		// Maximum corner of the box around the boids in each cell
+	std::vector< float >	m_X;			// Position of the boid in each slot, sorted by cell
+	std::vector< float >	m_Y;			// ...
+	std::vector< float >	m_Z;			// ...
+	std::vector< int >		m_Id;			// Index of the boid in each slot
+
+	std::vector< int >		m_Cell;			// Current cell of each boid
+	std::vector< int >		m_Slot;			// Slot of each boid, or -1 if it has moved to another cell
+
+	std::vector< int >		m_MovedHead;	// First moved boid in each cell, or -1
+	std::vector< int >		m_MovedNext;	// Next moved boid in the same cell, or -1
+	std::vector< int >		m_MovedPrev;	// Previous moved boid in the same cell, or -1
+	std::vector< Vector3f >	m_MovedPosition;// Position of each moved boid
+};
+
+
+#endif // !defined( BOIDGRID_H_INCLUDED )
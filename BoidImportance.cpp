@@ -0,0 +1,109 @@
+/*****************************************************************************
+
+                              BoidImportance.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidImportance.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "BoidImportance.h"
+
+#include "BoidArrays.h"
+#include "BoidGrid.h"
+#include "NeighborList.h"
+
+// Defined here as well as in the class, because std::min takes it by reference
+int const	BoidImportance::MAX_LEVEL;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+BoidImportance::~BoidImportance()
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+DistanceImportance::DistanceImportance( Vector3f const & center, float fullRateDistance )
+	: m_Center( center ),
+	m_FullRateDistance2( fullRateDistance * fullRateDistance )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int DistanceImportance::GetLevel( BoidArrays const & boids, BoidGrid const & /* grid */, int i ) const
+{
+	float const	dx	= boids.m_X[ i ] - m_Center.m_X;
+	float const	dy	= boids.m_Y[ i ] - m_Center.m_Y;
+	float const	dz	= boids.m_Z[ i ] - m_Center.m_Z;
+	float const	d2	= dx * dx + dy * dy + dz * dz;
+
+	// Each time the distance doubles, the square of the distance is 4 times larger
+
+	int		level	= 0;
+	float	limit2	= m_FullRateDistance2;
+
+	while ( d2 > limit2 && level < MAX_LEVEL )
+	{
+		limit2 *= 4.f;
+		++level;
+	}
+
+	return level;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NeighborImportance::NeighborImportance( float radius, int fullRateNeighbors )
+	: m_Radius( radius ),
+	m_FullRateNeighbors( fullRateNeighbors )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int NeighborImportance::GetLevel( BoidArrays const & boids, BoidGrid const & grid, int i ) const
+{
+	// Only the number of neighbors is needed, so the list has no room for them. The boid finds itself.
+
+	NeighborList	neighbors;
+	int const		count	= grid.FindWithin( boids.GetPosition( i ), m_Radius, neighbors ) - 1;
+
+	if ( count <= 0 )
+	{
+		return MAX_LEVEL;
+	}
+
+	int	level	= 0;
+
+	for ( int n = count; n < m_FullRateNeighbors && level < MAX_LEVEL - 1; n *= 2 )
+	{
+		++level;
+	}
+
+	return level;
+}
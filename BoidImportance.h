@@ -0,0 +1,104 @@
+#if !defined( BOIDIMPORTANCE_H_INCLUDED )
+#define BOIDIMPORTANCE_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                               BoidImportance.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidImportance.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "Math/Vector3f.h"
+
+class BoidArrays;
+class BoidGrid;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Decides how often a boid is updated (see Flock::SetImportance()).
+//
+// The level of detail of a boid is 0 if it is updated every time the flock is updated, 1 if it is updated every 2nd
+// time, 2 for every 4th time, and 3 (MAX_LEVEL) for every 8th time. The level of each boid is chosen once every 8
+// updates of the flock, when the boid is due at every level, so a metric can afford a neighbor search. GetLevel() may
+// be called by several threads at once.
+
+class BoidImportance
+{
+public:
+
+	// Least frequent level of detail
+	static int const	MAX_LEVEL	= 3;
+
+	virtual ~BoidImportance();
+
+	// Return the level of detail of the boid at the given index. The grid contains the boids.
+	virtual int	GetLevel( BoidArrays const & boids, BoidGrid const & grid, int i ) const = 0;
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Boids far from a point of interest (such as the camera) are less important. Boids within the given distance are
+// updated every time, and the rate is halved each time the distance doubles.
+
+class DistanceImportance : public BoidImportance
+{
+public:
+
+	DistanceImportance( Vector3f const & center, float fullRateDistance );
+
+	virtual int	GetLevel( BoidArrays const & boids, BoidGrid const & grid, int i ) const;
+
+	// Set the point of interest
+	void		SetCenter( Vector3f const & center )		{ m_Center = center; }
+
+	// Return the point of interest
+	Vector3f const &	GetCenter() const				{ return m_Center; }
+
+private:
+
+	Vector3f	m_Center;
+	float		m_FullRateDistance2;	// Square of the distance within which boids are updated every time
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Boids with few neighbors are less important. A boid with no neighbors within the given radius is updated every 8th
+// time. Otherwise, boids with at least the given number of neighbors are updated every time, and the rate is halved
+// each time the number of neighbors halves. Every boid within the radius is visited, so a radius smaller than the
+// perception distance is much cheaper in a crowded flock.
+
+class NeighborImportance : public BoidImportance
+{
+public:
+
+	NeighborImportance( float radius, int fullRateNeighbors );
+
+	virtual int	GetLevel( BoidArrays const & boids, BoidGrid const & grid, int i ) const;
+
+private:
+
+	float	m_Radius;
+	int		m_FullRateNeighbors;
+};
+
+
+#endif // !defined( BOIDIMPORTANCE_H_INCLUDED )
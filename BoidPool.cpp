@@ -0,0 +1,164 @@
+/*****************************************************************************
+
+                                 BoidPool.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidPool.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "BoidPool.h"
+
+#include <cassert>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include "Boid.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+BoidPool::BoidPool()
+	: m_pFree( 0 ),
+	m_Unused( 0 ),
+	m_Count( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+BoidPool::~BoidPool()
+{
+	Clear();
+
+	for ( std::vector< Slot * >::iterator ppPage = m_Pages.begin(); ppPage != m_Pages.end(); ++ppPage )
+	{
+		delete[] *ppPage;
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Boid * BoidPool::Allocate( Vector3f const & position, Vector3f const & velocity )
+{
+	Slot *	pSlot;
+
+	// Reuse a freed slot if there is one, otherwise take the next unused slot, adding a page if there are none
+
+	if ( m_pFree )
+	{
+		pSlot = m_pFree;
+		m_pFree = pSlot->m_pNext;
+	}
+	else
+	{
+		if ( m_Unused == 0 )
+		{
+			Slot * const	pPage	= new Slot[ PAGE_SIZE ];
+			if ( !pPage ) throw std::bad_alloc();
+
+			m_Pages.push_back( pPage );
+			m_Unused = PAGE_SIZE;
+		}
+
+		pSlot = m_Pages.back() + ( PAGE_SIZE - m_Unused );
+		--m_Unused;
+	}
+
+	++m_Count;
+
+	return new ( pSlot->m_Boid ) Boid( position, velocity );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidPool::Free( Boid * pBoid )
+{
+	assert( m_Count > 0 );
+
+	pBoid->~Boid();
+
+	Slot * const	pSlot	= reinterpret_cast< Slot * >( pBoid );
+
+	pSlot->m_pNext = m_pFree;
+	m_pFree = pSlot;
+
+	--m_Count;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void BoidPool::Clear()
+{
+	if ( m_Count > 0 )
+	{
+		// The slots holding boids are the ones that are not in the free list and not at the unused end of the last
+		// page. The free slots are found by looking up their pages in a sorted copy of the list of pages.
+
+		std::vector< Slot * >	pages( m_Pages );
+		std::vector< bool >		isFree( GetCapacity(), false );
+
+		std::sort( pages.begin(), pages.end() );
+
+		for ( Slot * pSlot = m_pFree; pSlot; pSlot = pSlot->m_pNext )
+		{
+			int const	page	= int( std::upper_bound( pages.begin(), pages.end(), pSlot ) - pages.begin() ) - 1;
+
+			isFree[ page * PAGE_SIZE + int( pSlot - pages[ page ] ) ] = true;
+		}
+
+		int const	lastPage	= int( std::find( pages.begin(), pages.end(), m_Pages.back() ) - pages.begin() );
+
+		for ( int i = PAGE_SIZE - m_Unused; i < PAGE_SIZE; i++ )
+		{
+			isFree[ lastPage * PAGE_SIZE + i ] = true;
+		}
+
+		for ( int i = 0; i < GetCapacity(); i++ )
+		{
+			if ( !isFree[ i ] )
+			{
+				reinterpret_cast< Boid * >( pages[ i / PAGE_SIZE ][ i % PAGE_SIZE ].m_Boid )->~Boid();
+			}
+		}
+	}
+
+	// Put every slot in the free list, in order, so that they are reused starting at the beginning of the first page
+
+	m_pFree		= 0;
+	m_Unused	= 0;
+	m_Count		= 0;
+
+	for ( int page = int( m_Pages.size() ) - 1; page >= 0; page-- )
+	{
+		for ( int i = PAGE_SIZE - 1; i >= 0; i-- )
+		{
+			Slot * const	pSlot	= m_Pages[ page ] + i;
+
+			pSlot->m_pNext = m_pFree;
+			m_pFree = pSlot;
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#if !defined( BOIDPOOL_H_INCLUDED )
+#define BOIDPOOL_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                  BoidPool.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/BoidPool.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include "Boid.h"
+
+class Vector3f;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Allocates Boid objects from pages of contiguous slots instead of the heap.
+//
+// Freed slots are kept in a free list and reused first, so allocating and freeing take constant time, the boids stay
+// packed into as few pages as possible, and boids that come and go do not fragment the heap. Pages are only returned
+// to the heap when the pool is destroyed.
+
+class BoidPool
+{
+public:
+
+	// Number of boids in a page
+	static int const	PAGE_SIZE	= 256;
+
+	BoidPool();
+	~BoidPool();
+
+	// Construct a boid in a free slot and return it
+	Boid *	Allocate( Vector3f const & position, Vector3f const & velocity );
+
+	// Destroy a boid allocated by this pool and free its slot
+	void	Free( Boid * pBoid );
+
+	// Destroy all of the boids allocated by this pool. The pages are kept for reuse.
+	void	Clear();
+
+	// Return the number of boids allocated
+	int		GetCount() const							{ return m_Count; }
+
+	// Return the number of slots in the pages
+	int		GetCapacity() const							{ return int( m_Pages.size() ) * PAGE_SIZE; }
+
+private:
+
+	// A slot holds a boid, or the link to the next free slot
+	union Slot
+	{
+		Slot *	m_pNext;
+		double	m_Align;
+		char	m_Boid[ sizeof( Boid ) ];
+	};
+
+	// Prevent copying
+	BoidPool( BoidPool const & );
+	BoidPool & operator =( BoidPool const & );
+
+	std::vector< Slot * >	m_Pages;		// Each page is an array of PAGE_SIZE slots
+	Slot *					m_pFree;		// First free slot that has been used before, or 0
+	int						m_Unused;		// Number of slots at the end of the last page that have never been used
+	int						m_Count;		// Number of boids allocated
+};
+
+
+#endif // !defined( BOIDPOOL_H_INCLUDED )
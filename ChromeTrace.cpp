@@ -0,0 +1,350 @@
+/*****************************************************************************
+
+                                ChromeTrace.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/ChromeTrace.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "ChromeTrace.h"
+
+#include <cstdio>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+namespace
+{
+
+// How long the writer waits between emptying the ring buffer
+int const	WRITE_INTERVAL_MS	= 10;
+
+// An event in the ring buffer
+struct Event
+{
+	char const *	m_Name;
+	char			m_Phase;		// 'X' for a complete event, 'C' for a counter
+	int				m_ThreadId;
+	long long		m_Start;		// Nanoseconds since tracing started
+	long long		m_Duration;		// Nanoseconds (complete events only)
+	double			m_Value;		// Counters only
+};
+
+// A slot in the ring buffer. The sequence number tells the producers and the consumer whose turn it is: a producer
+// may fill the slot for position p when the sequence is p, and the consumer may read it when the sequence is p + 1.
+struct Slot
+{
+	std::atomic< unsigned int >	m_Sequence;
+	Event						m_Event;
+};
+
+// The state of a trace that has been started
+struct Trace
+{
+	FILE *									m_pFile;
+	std::vector< Slot >						m_Slots;
+	unsigned int							m_Mask;			// Number of slots - 1
+	std::atomic< unsigned int >				m_Enqueue;		// Next position to be filled
+	unsigned int							m_Dequeue;		// Next position to be written (writer thread only)
+	std::atomic< bool >						m_Quit;
+	std::thread								m_Writer;
+	std::chrono::steady_clock::time_point	m_Start;
+	bool									m_First;		// True until the first event is written
+
+	Trace( int capacity ) : m_Slots( capacity )	{}
+};
+
+std::atomic< Trace * >	s_pTrace( 0 );
+std::atomic< int >		s_Dropped( 0 );
+std::atomic< int >		s_NextThreadId( 1 );
+
+
+// Return a small number identifying the calling thread
+
+int GetThreadId()
+{
+	static thread_local int	s_ThreadId	= 0;
+
+	if ( s_ThreadId == 0 )
+	{
+		s_ThreadId = s_NextThreadId++;
+	}
+
+	return s_ThreadId;
+}
+
+
+// Return the time since tracing started, in nanoseconds
+
+long long Now( Trace const & trace )
+{
+	std::chrono::steady_clock::duration const	elapsed	= std::chrono::steady_clock::now() - trace.m_Start;
+
+	return std::chrono::duration_cast< std::chrono::nanoseconds >( elapsed ).count();
+}
+
+
+// Add an event to the ring buffer, or drop it if the buffer is full
+
+void Push( Trace & trace, Event const & event )
+{
+	unsigned int	position	= trace.m_Enqueue.load( std::memory_order_relaxed );
+	Slot *			pSlot;
+
+	for ( ;; )
+	{
+		pSlot = &trace.m_Slots[ position & trace.m_Mask ];
+
+		int const	difference	= int( pSlot->m_Sequence.load( std::memory_order_acquire ) - position );
+
+		if ( difference == 0 )
+		{
+			// The slot is free. Claim it, unless another producer got there first.
+
+			if ( trace.m_Enqueue.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+			{
+				break;
+			}
+		}
+		else if ( difference < 0 )
+		{
+			// The slot has not been written yet, so the buffer is full
+
+			++s_Dropped;
+			return;
+		}
+		else
+		{
+			position = trace.m_Enqueue.load( std::memory_order_relaxed );
+		}
+	}
+
+	pSlot->m_Event = event;
+	pSlot->m_Sequence.store( position + 1, std::memory_order_release );
+}
+
+
+// Write the events in the ring buffer to the file
+
+void Drain( Trace & trace )
+{
+	for ( ;; )
+	{
+		Slot &	slot	= trace.m_Slots[ trace.m_Dequeue & trace.m_Mask ];
+
+		if ( slot.m_Sequence.load( std::memory_order_acquire ) != trace.m_Dequeue + 1 )
+		{
+			break;
+		}
+
+		Event const &	event	= slot.m_Event;
+
+		fputs( trace.m_First ? "\n" : ",\n", trace.m_pFile );
+		trace.m_First = false;
+
+		if ( event.m_Phase == 'X' )
+		{
+			fprintf( trace.m_pFile, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+					 event.m_Name, event.m_Start * .001, event.m_Duration * .001, event.m_ThreadId );
+		}
+		else
+		{
+			fprintf( trace.m_pFile, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+					 "\"args\":{\"value\":%g}}",
+					 event.m_Name, event.m_Start * .001, event.m_ThreadId, event.m_Value );
+		}
+
+		// The slot can be reused when the producers come around to it again
+
+		slot.m_Sequence.store( trace.m_Dequeue + trace.m_Mask + 1, std::memory_order_release );
+		++trace.m_Dequeue;
+	}
+}
+
+
+// Thread function for the writer
+
+void WriterMain( Trace * pTrace )
+{
+	while ( !pTrace->m_Quit.load() )
+	{
+		Drain( *pTrace );
+		std::this_thread::sleep_for( std::chrono::milliseconds( WRITE_INTERVAL_MS ) );
+	}
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool ChromeTrace::Start( char const * fileName, int capacity )
+{
+	if ( s_pTrace.load() )
+	{
+		return false;
+	}
+
+	FILE * const	pFile	= fopen( fileName, "w" );
+
+	if ( !pFile )
+	{
+		return false;
+	}
+
+	int	size	= 2;
+
+	while ( size < capacity )
+	{
+		size *= 2;
+	}
+
+	Trace * const	pTrace	= new Trace( size );
+	if ( !pTrace ) throw std::bad_alloc();
+
+	for ( int i = 0; i < size; i++ )
+	{
+		pTrace->m_Slots[ i ].m_Sequence.store( i, std::memory_order_relaxed );
+	}
+
+	pTrace->m_pFile		= pFile;
+	pTrace->m_Mask		= size - 1;
+	pTrace->m_Enqueue	= 0;
+	pTrace->m_Dequeue	= 0;
+	pTrace->m_Quit		= false;
+	pTrace->m_Start		= std::chrono::steady_clock::now();
+	pTrace->m_First		= true;
+
+	fputs( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", pFile );
+
+	s_Dropped = 0;
+	pTrace->m_Writer = std::thread( WriterMain, pTrace );
+	s_pTrace = pTrace;
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void ChromeTrace::Stop()
+{
+	Trace * const	pTrace	= s_pTrace.exchange( 0 );
+
+	if ( !pTrace )
+	{
+		return;
+	}
+
+	pTrace->m_Quit = true;
+	pTrace->m_Writer.join();
+
+	Drain( *pTrace );
+
+	fputs( "\n]}\n", pTrace->m_pFile );
+	fclose( pTrace->m_pFile );
+
+	delete pTrace;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool ChromeTrace::IsActive()
+{
+	return s_pTrace.load( std::memory_order_relaxed ) != 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int ChromeTrace::GetDroppedCount()
+{
+	return s_Dropped.load();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void ChromeTrace::Counter( char const * name, double value )
+{
+	Trace * const	pTrace	= s_pTrace.load( std::memory_order_acquire );
+
+	if ( pTrace )
+	{
+		Event	event;
+
+		event.m_Name		= name;
+		event.m_Phase		= 'C';
+		event.m_ThreadId	= GetThreadId();
+		event.m_Start		= Now( *pTrace );
+		event.m_Duration	= 0;
+		event.m_Value		= value;
+
+		Push( *pTrace, event );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+ChromeTrace::Scope::Scope( char const * name )
+	: m_Name( name ),
+	m_Start( -1 )
+{
+	Trace const * const	pTrace	= s_pTrace.load( std::memory_order_acquire );
+
+	if ( pTrace )
+	{
+		m_Start = Now( *pTrace );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+ChromeTrace::Scope::~Scope()
+{
+	Trace * const	pTrace	= s_pTrace.load( std::memory_order_acquire );
+
+	if ( pTrace && m_Start >= 0 )
+	{
+		Event	event;
+
+		event.m_Name		= m_Name;
+		event.m_Phase		= 'X';
+		event.m_ThreadId	= GetThreadId();
+		event.m_Start		= m_Start;
+		event.m_Duration	= Now( *pTrace ) - m_Start;
+		event.m_Value		= 0.;
+
+		Push( *pTrace, event );
+	}
+}
@@ -0,0 +1,74 @@
+#if !defined( CHROMETRACE_H_INCLUDED )
+#define CHROMETRACE_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                 ChromeTrace.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/ChromeTrace.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// A timeline of the phases of each frame, written to a file in the Chrome trace event format, which can be opened in
+// Perfetto (ui.perfetto.dev) or chrome://tracing.
+//
+// Events are recorded by any thread into a fixed-size ring buffer without taking a lock, and a background thread
+// writes them to the file. If the ring buffer fills up faster than it is written, then the new events are dropped
+// and counted. When tracing has not been started, recording an event costs one atomic load.
+//
+// The names of the events are not copied, so they must be string literals (or last until tracing stops), and they
+// are written as they are, so they must not contain quotes or backslashes.
+
+namespace ChromeTrace
+{
+
+// Start writing events to the given file, with room for the given number of events in the ring buffer (rounded up
+// to a power of 2). Returns false if tracing has already started or if the file cannot be created.
+bool		Start( char const * fileName, int capacity = 1 << 16 );
+
+// Write the remaining events and close the file. No other thread may be recording events.
+void		Stop();
+
+// Return true if tracing has started
+bool		IsActive();
+
+// Return the number of events dropped because the ring buffer was full, since tracing started
+int			GetDroppedCount();
+
+// Record a value that changes over time, such as the number of boids, at the current time
+void		Counter( char const * name, double value );
+
+// Records the time from its construction to its destruction as an event, if tracing was active when it was constructed
+class Scope
+{
+public:
+
+	explicit Scope( char const * name );
+	~Scope();
+
+private:
+
+	// Prevent copying
+	Scope( Scope const & );
+	Scope & operator =( Scope const & );
+
+	char const *	m_Name;
+	long long		m_Start;	// Time the scope was entered in nanoseconds, or -1 if tracing was not active
+};
+
+} // namespace ChromeTrace
+
+
+#endif // !defined( CHROMETRACE_H_INCLUDED )
@@ -13,15 +13,95 @@
 
 #include "Flock.h"
 
+#include <cassert>
+#include <thread>
+#include <algorithm>
 #include "Boid.h"
+#include "BoidArrays.h"
+#include "BoidGrid.h"
+#include "BoidImportance.h"
+#include "WorkerPool.h"
+#include "TerrainCache.h"
+#include "MortonOrder.h"
+#include "FlockProfile.h"
+#include "ChromeTrace.h"
+#include "Heightfield/Heightfield.h"
+
+namespace
+{
+
+// Number of boids handed to a thread at a time
+int const	CHUNK_SIZE	= 256;
+
+// Default fraction of the boids that can be out of their slots in the grid before it is rebuilt
+float const	DEFAULT_REBUILD_THRESHOLD	= .01f;
+
+// Default number of updates between sorts of the arrays
+int const	DEFAULT_SORT_INTERVAL		= 16;
+
+// Number of updates between updates of a boid at the lowest level of detail
+unsigned int const	LOD_PERIOD	= 1 << BoidImportance::MAX_LEVEL;
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Updates a range of boids on one of the threads
+
+class Flock::UpdateTask : public WorkerPool::Task
+{
+public:
+
+	UpdateTask( Flock & flock, float dt, HeightField const & terrain, float xyScale, float seaLevel )
+		: m_Flock( flock ), m_Dt( dt ), m_Terrain( terrain ), m_XYScale( xyScale ), m_SeaLevel( seaLevel )
+	{
+	}
+
+	virtual void Execute( int begin, int end )
+	{
+		m_Flock.UpdateRange( begin, end, m_Dt, m_Terrain, m_XYScale, m_SeaLevel );
+	}
+
+private:
+
+	// Prevent assignment
+	UpdateTask & operator =( UpdateTask const & );
+
+	Flock &				m_Flock;
+	float				m_Dt;
+	HeightField const &	m_Terrain;
+	float				m_XYScale;
+	float				m_SeaLevel;
+};
+
 
 /********************************************************************************************************************/
 /*																													*/
 /*																													*/
 /********************************************************************************************************************/
 
-Flock::Flock()
+Flock::Flock( StorageMode storageMode )
+	: m_StorageMode( storageMode ),
+	m_UpdateMode( UPDATE_IN_PLACE ),
+	m_IndexMode( INDEX_INCREMENTAL ),
+	m_RebuildThreshold( DEFAULT_REBUILD_THRESHOLD ),
+	m_TerrainSampling( TerrainCache::SAMPLE_NEAREST ),
+	m_pWorkers( 0 ),
+	m_GridIsCurrent( false ),
+	m_WorldSizeX( 0.f ),
+	m_WorldSizeY( 0.f ),
+	m_SortInterval( DEFAULT_SORT_INTERVAL ),
+	m_UpdatesSinceSort( 0 ),
+	m_pImportance( 0 ),
+	m_Tick( 0 ),
+	m_UpdatedCount( 0 )
 {
+	m_IndexStats.m_CellChanges	= 0;
+	m_IndexStats.m_Displaced	= 0;
+	m_IndexStats.m_Rebuilt		= false;
 }
 
 
@@ -32,6 +112,7 @@ Flock::Flock()
 
 Flock::~Flock()
 {
+	delete m_pWorkers;
 }
 
 
@@ -42,8 +123,881 @@ Flock::~Flock()
 
 void Flock::Update( float dt, HeightField const & terrain, float xyScale, float seaLevel )
 {
-	for ( iterator ppB = begin(); ppB != end(); ++ppB )
+	FLOCKPROFILE_TRACE_SCOPE( TIMER_FLOCK_UPDATE, "Flock::Update" );
+
+	// Boids may have been added to or removed from the list directly since the last update
+
+	SyncHandles();
+
+	int const	n	= GetCount();
+
+	ChromeTrace::Counter( "boids", n );
+
+	// Bring the grid up to date. It covers the terrain, which is where Boid::Wrap keeps the boids, and it wraps in the
+	// same way. The neighbor searches always use the arrays, so if the boids are objects, their state is copied first.
+
+	m_WorldSizeX = ( terrain.GetSizeX() - 1.f ) * xyScale;
+	m_WorldSizeY = ( terrain.GetSizeY() - 1.f ) * xyScale;
+
+	{
+		FLOCKPROFILE_TRACE_SCOPE( TIMER_GRID, "grid" );
+
+		// Boid objects can be changed without the flock knowing, so their state is copied by every update
+
+		if ( m_StorageMode == STORAGE_OBJECTS )
+		{
+			m_GridIsCurrent = false;
+		}
+
+		// Sort the boids from time to time, because they drift apart in memory as they move. The grid is rebuilt after
+		// a sort.
+
+		if ( m_StorageMode == STORAGE_ARRAYS && m_SortInterval > 0 && ++m_UpdatesSinceSort >= m_SortInterval )
+		{
+			SortBoids();
+			m_UpdatesSinceSort = 0;
+		}
+
+		if ( m_IndexMode == INDEX_REBUILD )
+		{
+			m_GridIsCurrent = false;
+		}
+
+		m_Grid.ResetCellChangeCount();
+		m_IndexStats.m_Rebuilt = RefreshGrid();
+	}
+
+	{
+		FLOCKPROFILE_TRACE_SCOPE( TIMER_TERRAIN, "terrain" );
+
+		// The terrain cache is only rebuilt when the terrain or the sea level changes
+
+		m_TerrainCache.Refresh( terrain, xyScale, seaLevel );
+
+		// A boid's own position does not change until it is updated, so the heights below all of the boids can be
+		// found in one pass in either update mode
+
+		m_TerrainHeights.resize( n );
+
+		if ( n > 0 )
+		{
+			m_TerrainCache.SampleHeights( &m_Arrays.m_X[ 0 ], &m_Arrays.m_Y[ 0 ], n, &m_TerrainHeights[ 0 ],
+										  m_TerrainSampling );
+			FLOCKPROFILE_COUNT( COUNTER_TERRAIN_SAMPLES, n );
+		}
+	}
+
+	// The level of detail is kept by handle, so that it stays with the boid when its ID or index changes. It is still
+	// used for one update after the metric is removed, so that the boids that are waiting catch up.
+
+	if ( m_pImportance || !m_Lod.empty() )
+	{
+		LodState const	fullRate	= { 0.f, 0 };
+
+		m_Lod.resize( m_Handles.size(), fullRate );
+	}
+
+	m_UpdatedCount = 0;
+
+	{
+		FLOCKPROFILE_TRACE_SCOPE( TIMER_BOIDS, "update boids" );
+
+		if ( m_UpdateMode == UPDATE_DOUBLE_BUFFERED )
+		{
+			// Compute the next state from the current state and then make it the current state
+
+			m_NextArrays.Resize( n );
+
+			if ( m_pWorkers )
+			{
+				UpdateTask	task( *this, dt, terrain, xyScale, seaLevel );
+
+				m_pWorkers->Run( task, n, CHUNK_SIZE );
+			}
+			else
+			{
+				UpdateRange( 0, n, dt, terrain, xyScale, seaLevel );
+			}
+
+			m_Arrays.Swap( m_NextArrays );
+
+			// The grid still holds the previous state. Most boids stay in the same cell from one update to the next, so
+			// moving the ones that have changed cells is much cheaper than rebuilding the grid.
+
+			if ( m_IndexMode == INDEX_INCREMENTAL )
+			{
+				MoveGrid();
+				m_GridIsCurrent = true;
+			}
+			else
+			{
+				m_GridIsCurrent = false;
+			}
+
+			if ( m_StorageMode == STORAGE_OBJECTS )
+			{
+				for ( int i = 0; i < n; i++ )
+				{
+					Boid * const	pBoid	= ( *this )[ i ];
+
+					pBoid->m_Position = m_Arrays.GetPosition( i );
+					pBoid->m_Velocity = m_Arrays.GetVelocity( i );
+				}
+			}
+		}
+		else
+		{
+			int	updated	= 0;
+
+			for ( int i = 0; i < n; i++ )
+			{
+				float	step	= dt;
+
+				if ( !m_Lod.empty() && !TakeStep( i, dt, step ) )
+				{
+					continue;
+				}
+
+				if ( m_StorageMode == STORAGE_OBJECTS )
+				{
+					Boid * const	pBoid	= ( *this )[ i ];
+
+					pBoid->Update( step, m_Arrays, terrain, xyScale, seaLevel, &m_Grid,
+								   &m_TerrainCache, &m_TerrainHeights[ i ] );
+
+					m_Arrays.SetPosition( i, pBoid->m_Position );
+					m_Arrays.SetVelocity( i, pBoid->m_Velocity );
+				}
+				else
+				{
+					Boid	boid( m_Arrays.GetPosition( i ), m_Arrays.GetVelocity( i ) );
+
+					boid.Update( step, m_Arrays, terrain, xyScale, seaLevel, &m_Grid,
+								 &m_TerrainCache, &m_TerrainHeights[ i ] );
+
+					m_Arrays.SetPosition( i, boid.m_Position );
+					m_Arrays.SetVelocity( i, boid.m_Velocity );
+				}
+
+				// The boids are updated in place, so the grid must follow each boid as it moves
+
+				m_Grid.Move( i, m_Arrays.GetPosition( i ) );
+
+				++updated;
+			}
+
+			m_UpdatedCount = updated;
+			m_GridIsCurrent = true;
+		}
+	}
+
+	if ( !m_pImportance )
+	{
+		m_Lod.clear();
+	}
+
+	ChromeTrace::Counter( "boids updated", m_UpdatedCount );
+
+	++m_Tick;
+
+	m_IndexStats.m_CellChanges	= m_Grid.GetCellChangeCount();
+	m_IndexStats.m_Displaced	= m_Grid.GetDisplacedCount();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::FindNearest( Vector3f const & position, float maxDistance, int k, NeighborList & neighbors )
+{
+	RefreshGrid();
+
+	int const	count	= m_Grid.FindNearest( position, maxDistance, k, neighbors );
+
+	SlotsToIds( neighbors );
+
+	return count;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::FindWithin( Vector3f const & position, float radius, NeighborList & neighbors )
+{
+	RefreshGrid();
+
+	int const	count	= m_Grid.FindWithin( position, radius, neighbors );
+
+	SlotsToIds( neighbors );
+
+	return count;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::FindInFrustum( Frustum const & frustum, float margin, std::vector< int > & ids )
+{
+	RefreshGrid();
+
+	int const	first	= int( ids.size() );
+	int const	count	= m_Grid.FindInFrustum( frustum, margin, ids );
+
+	if ( m_StorageMode == STORAGE_ARRAYS )
+	{
+		for ( int i = first; i < first + count; i++ )
+		{
+			ids[ i ] = m_IdOfSlot[ ids[ i ] ];
+		}
+	}
+
+	return count;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::CopyObjectsToArrays()
+{
+	int const	n	= int( size() );
+
+	m_Arrays.Resize( n );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		Boid const * const	pBoid	= ( *this )[ i ];
+
+		m_Arrays.SetPosition( i, pBoid->m_Position );
+		m_Arrays.SetVelocity( i, pBoid->m_Velocity );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool Flock::RefreshGrid()
+{
+	// The state of the boid objects is only copied when the grid is out of date, so that queries between updates do
+	// not visit the whole flock
+
+	if ( m_StorageMode == STORAGE_OBJECTS && !m_GridIsCurrent )
+	{
+		CopyObjectsToArrays();
+	}
+
+	// The grid can be kept if it was built for the same boids and area, and not too many boids have left their slots
+
+	int const	n			= m_Arrays.Size();
+	bool const	canKeep		= m_Grid.IsBuiltFor( n, m_WorldSizeX, m_WorldSizeY, Boid::MAX_PERCEPTION_DISTANCE, true ) &&
+							  m_Grid.GetDisplacedCount() <= int( m_RebuildThreshold * n );
+
+	if ( canKeep && m_GridIsCurrent )
+	{
+		return false;
+	}
+
+	if ( canKeep && m_IndexMode == INDEX_INCREMENTAL )
+	{
+		MoveGrid();
+		m_GridIsCurrent = true;
+		return false;
+	}
+
+	m_Grid.Build( m_Arrays, m_WorldSizeX, m_WorldSizeY, Boid::MAX_PERCEPTION_DISTANCE, true );
+	m_GridIsCurrent = true;
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::SortBoids()
+{
+	int const	n	= m_Arrays.Size();
+
+	MortonOrder::Sort( m_Arrays, m_WorldSizeX, m_WorldSizeY, m_SortOrder, m_SortWorkspace );
+
+	m_NextArrays.Gather( m_Arrays, m_SortOrder );
+	m_Arrays.Swap( m_NextArrays );
+
+	// The boid now at index i was at index m_SortOrder[ i ]. Its ID goes with it. The new table is built in the spare
+	// one, and the two are swapped.
+
+	m_SortedIds.resize( n );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		int const	id	= m_IdOfSlot[ m_SortOrder[ i ] ];
+
+		m_SortedIds[ i ] = id;
+		m_SlotOfId[ id ] = i;
+	}
+
+	m_IdOfSlot.swap( m_SortedIds );
+
+	// The grid refers to the boids by index
+
+	m_Grid.Invalidate();
+	m_GridIsCurrent = false;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::SlotsToIds( NeighborList & neighbors ) const
+{
+	if ( m_StorageMode == STORAGE_ARRAYS )
+	{
+		for ( int i = 0; i < neighbors.m_Size; i++ )
+		{
+			neighbors.m_Neighbors[ i ].m_Index = m_IdOfSlot[ neighbors.m_Neighbors[ i ].m_Index ];
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::MoveGrid()
+{
+	int const	n	= m_Arrays.Size();
+
+	// A boid that is still in the same cell only has its position updated
+
+	for ( int i = 0; i < n; i++ )
+	{
+		m_Grid.Move( i, m_Arrays.GetPosition( i ) );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::SetThreadCount( int nThreads )
+{
+	if ( nThreads <= 0 )
+	{
+		nThreads = std::max( int( std::thread::hardware_concurrency() ), 1 );
+	}
+
+	if ( nThreads == GetThreadCount() )
+	{
+		return;
+	}
+
+	delete m_pWorkers;
+	m_pWorkers = ( nThreads > 1 ) ? new WorkerPool( nThreads ) : 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::GetThreadCount() const
+{
+	return m_pWorkers ? m_pWorkers->GetThreadCount() : 1;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::UpdateRange( int begin, int end,
+						 float dt, HeightField const & terrain, float xyScale, float seaLevel )
+{
+	// Only the current state and the grid are read, and only the next state of the boids in the range is written, so
+	// ranges can be updated in any order, or at the same time.
+
+	int	updated	= 0;
+
+	for ( int i = begin; i < end; i++ )
+	{
+		float	step	= dt;
+
+		// A boid that is not due keeps its state
+
+		if ( !m_Lod.empty() && !TakeStep( i, dt, step ) )
+		{
+			m_NextArrays.SetPosition( i, m_Arrays.GetPosition( i ) );
+			m_NextArrays.SetVelocity( i, m_Arrays.GetVelocity( i ) );
+			continue;
+		}
+
+		Boid	boid( m_Arrays.GetPosition( i ), m_Arrays.GetVelocity( i ) );
+
+		boid.Update( step, m_Arrays, terrain, xyScale, seaLevel, &m_Grid, &m_TerrainCache, &m_TerrainHeights[ i ] );
+
+		m_NextArrays.SetPosition( i, boid.m_Position );
+		m_NextArrays.SetVelocity( i, boid.m_Velocity );
+
+		++updated;
+	}
+
+	m_UpdatedCount += updated;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool Flock::TakeStep( int slot, float dt, float & step )
+{
+	// Each boid has its own entry, so boids can be stepped at the same time by different threads
+
+	int const			handle	= m_HandleOfId[ GetId( slot ) ];
+	LodState &			lod		= m_Lod[ handle ];
+	unsigned int const	phase	= m_Tick + handle;
+
+	// The phase is offset by the handle so that the boids at each level are spread evenly over the updates. A boid is
+	// due at every level when the phase is a multiple of LOD_PERIOD, so that is when its level is chosen.
+
+	if ( m_pImportance && phase % LOD_PERIOD == 0 )
+	{
+		lod.m_Level = ( unsigned char )( std::min( std::max( m_pImportance->GetLevel( m_Arrays, m_Grid, slot ), 0 ),
+													 BoidImportance::MAX_LEVEL ) );
+	}
+
+	lod.m_PendingDt += dt;
+
+	// Without a metric, every boid is due, so the boids that are waiting catch up
+
+	if ( m_pImportance && ( phase & ( ( 1u << lod.m_Level ) - 1 ) ) != 0 )
+	{
+		return false;
+	}
+
+	step = lod.m_PendingDt;
+	lod.m_PendingDt = 0.f;
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::Add( Vector3f const & position, Vector3f const & velocity )
+{
+	SyncHandles();
+
+	m_GridIsCurrent = false;
+
+	// The IDs and the slots are dense, so the new boid gets the next ID and the next slot
+
+	int	id;
+
+	if ( m_StorageMode == STORAGE_OBJECTS )
+	{
+		push_back( m_BoidPool.Allocate( position, velocity ) );
+		m_IsPooled.push_back( true );
+		id = int( size() ) - 1;
+	}
+	else
+	{
+		id = m_Arrays.Add( position, velocity );
+
+		m_SlotOfId.push_back( id );
+		m_IdOfSlot.push_back( id );
+	}
+
+	m_HandleOfId.push_back( NewHandle( id ) );
+
+	return id;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::Remove( int id )
+{
+	SyncHandles();
+
+	int const	last	= GetCount() - 1;
+
+	FreeHandle( m_HandleOfId[ id ] );
+
+	if ( m_StorageMode == STORAGE_OBJECTS )
+	{
+		// The ID is the index in the list, so the last boid in the list takes its place. Only the boids that came
+		// from the pool are freed.
+
+		Boid * const	pBoid	= ( *this )[ id ];
+		bool const		pooled	= m_IsPooled[ id ];
+
+		( *this )[ id ] = back();
+		pop_back();
+
+		m_IsPooled[ id ] = m_IsPooled[ last ];
+		m_IsPooled.pop_back();
+
+		if ( pooled )
+		{
+			m_BoidPool.Free( pBoid );
+		}
+	}
+	else
+	{
+		// The boid in the last slot moves into the removed boid's slot
+
+		int const	slot	= m_SlotOfId[ id ];
+
+		if ( slot != last )
+		{
+			int const	movedId	= m_IdOfSlot[ last ];
+
+			m_Arrays.SetPosition( slot, m_Arrays.GetPosition( last ) );
+			m_Arrays.SetVelocity( slot, m_Arrays.GetVelocity( last ) );
+			m_IdOfSlot[ slot ] = movedId;
+			m_SlotOfId[ movedId ] = slot;
+		}
+
+		m_Arrays.Resize( last );
+		m_IdOfSlot.pop_back();
+
+		// The boid with the last ID takes the removed boid's ID
+
+		if ( id != last )
+		{
+			int const	lastSlot	= m_SlotOfId[ last ];
+
+			m_SlotOfId[ id ] = lastSlot;
+			m_IdOfSlot[ lastSlot ] = id;
+		}
+
+		m_SlotOfId.pop_back();
+	}
+
+	if ( id != last )
+	{
+		m_HandleOfId[ id ] = m_HandleOfId[ last ];
+		m_Handles[ m_HandleOfId[ id ] ].m_Id = id;
+	}
+
+	m_HandleOfId.pop_back();
+
+	m_GridIsCurrent = false;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::RemoveAll()
+{
+	for ( std::vector< int >::const_iterator pH = m_HandleOfId.begin(); pH != m_HandleOfId.end(); ++pH )
+	{
+		FreeHandle( *pH );
+	}
+
+	m_HandleOfId.clear();
+
+	clear();
+	m_IsPooled.clear();
+	m_BoidPool.Clear();
+
+	m_Arrays.Clear();
+	m_SlotOfId.clear();
+	m_IdOfSlot.clear();
+
+	m_GridIsCurrent = false;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::Spawn( int count, Vector3f const * positions, Vector3f const * velocities, Handle * handles )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		int const	id	= Add( positions[ i ], velocities[ i ] );
+
+		if ( handles )
+		{
+			handles[ i ] = GetHandle( id );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::Despawn( int count, Handle const * handles )
+{
+	int	removed	= 0;
+
+	for ( int i = 0; i < count; i++ )
+	{
+		int const	id	= GetId( handles[ i ] );
+
+		if ( id >= 0 )
+		{
+			Remove( id );
+			++removed;
+		}
+	}
+
+	return removed;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Flock::Handle Flock::GetHandle( int id ) const
+{
+	Handle	handle	= { -1, 0 };
+
+	if ( id < int( m_HandleOfId.size() ) )
+	{
+		handle.m_Index		= m_HandleOfId[ id ];
+		handle.m_Generation	= m_Handles[ handle.m_Index ].m_Generation;
+	}
+
+	return handle;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::GetId( Handle handle ) const
+{
+	if ( handle.m_Index < 0 ||
+		 handle.m_Index >= int( m_Handles.size() ) ||
+		 m_Handles[ handle.m_Index ].m_Generation != handle.m_Generation )
+	{
+		return -1;
+	}
+
+	return m_Handles[ handle.m_Index ].m_Id;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::NewHandle( int id )
+{
+	int	index;
+
+	if ( !m_FreeHandles.empty() )
+	{
+		index = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+	}
+	else
+	{
+		HandleEntry const	entry	= { -1, 1 };
+
+		index = int( m_Handles.size() );
+		m_Handles.push_back( entry );
+	}
+
+	m_Handles[ index ].m_Id = id;
+
+	return index;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::FreeHandle( int index )
+{
+	HandleEntry &	entry	= m_Handles[ index ];
+
+	// Generation 0 is never used, so that a handle that has not been set never matches
+
+	entry.m_Id = -1;
+	if ( ++entry.m_Generation == 0 )
+	{
+		entry.m_Generation = 1;
+	}
+
+	// The next boid to get this entry starts at the full rate
+
+	if ( index < int( m_Lod.size() ) )
+	{
+		m_Lod[ index ].m_PendingDt	= 0.f;
+		m_Lod[ index ].m_Level		= 0;
+	}
+
+	m_FreeHandles.push_back( index );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::SyncHandles()
+{
+	if ( m_StorageMode != STORAGE_OBJECTS )
+	{
+		return;
+	}
+
+	int const	n	= int( size() );
+
+	// Boids added to the list directly are the caller's, so they are not freed when they are removed
+
+	while ( int( m_HandleOfId.size() ) > n )
+	{
+		FreeHandle( m_HandleOfId.back() );
+		m_HandleOfId.pop_back();
+		m_IsPooled.pop_back();
+	}
+
+	while ( int( m_HandleOfId.size() ) < n )
+	{
+		m_HandleOfId.push_back( NewHandle( int( m_HandleOfId.size() ) ) );
+		m_IsPooled.push_back( false );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::GetCount() const
+{
+	return ( m_StorageMode == STORAGE_OBJECTS ) ? int( size() ) : m_Arrays.Size();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::GetSlot( int id ) const
+{
+	return ( m_StorageMode == STORAGE_OBJECTS ) ? id : m_SlotOfId[ id ];
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int Flock::GetId( int slot ) const
+{
+	return ( m_StorageMode == STORAGE_OBJECTS ) ? slot : m_IdOfSlot[ slot ];
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Vector3f Flock::GetPosition( int id ) const
+{
+	return ( m_StorageMode == STORAGE_OBJECTS ) ? ( *this )[ id ]->m_Position : m_Arrays.GetPosition( m_SlotOfId[ id ] );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Vector3f Flock::GetVelocity( int id ) const
+{
+	return ( m_StorageMode == STORAGE_OBJECTS ) ? ( *this )[ id ]->m_Velocity : m_Arrays.GetVelocity( m_SlotOfId[ id ] );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::SetPosition( int id, Vector3f const & position )
+{
+	if ( m_StorageMode == STORAGE_OBJECTS )
+	{
+		( *this )[ id ]->m_Position = position;
+	}
+	else
+	{
+		m_Arrays.SetPosition( m_SlotOfId[ id ], position );
+	}
+
+	m_GridIsCurrent = false;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Flock::SetVelocity( int id, Vector3f const & velocity )
+{
+	if ( m_StorageMode == STORAGE_OBJECTS )
+	{
+		( *this )[ id ]->m_Velocity = velocity;
+	}
+	else
 	{
-		( *ppB )->Update( dt, *this, terrain, xyScale, seaLevel );
+		m_Arrays.SetVelocity( m_SlotOfId[ id ], velocity );
 	}
 }
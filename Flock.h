@@ -16,9 +16,20 @@
 
 *****************************************************************************/
 
+#include <vector>
+#include <atomic>
 #include "Boid.h"
+#include "BoidArrays.h"
+#include "BoidGrid.h"
+#include "BoidPool.h"
+#include "MortonOrder.h"
+#include "NeighborList.h"
+#include "TerrainCache.h"
 
+class BoidImportance;
+class Frustum;
 class HeightField;
+class WorkerPool;
 
 /********************************************************************************************************************/
 /*																													*/
@@ -29,10 +40,291 @@ class Flock : public BoidList
 {
 public:
 
-	Flock();
+	// How the state of the boids is stored
+	enum StorageMode
+	{
+		STORAGE_OBJECTS,	// Boid objects in the list, allocated by Add() or owned by the caller
+		STORAGE_ARRAYS		// Contiguous arrays owned by the flock (see GetArrays())
+	};
+
+	// How the boids are updated
+	enum UpdateMode
+	{
+		UPDATE_IN_PLACE,		// Each boid sees the boids before it in their new state (the results depend on the order)
+		UPDATE_DOUBLE_BUFFERED	// Every boid sees the state at the start of the update (the results do not depend on the order)
+	};
+
+	// How the grid used to find neighbors is kept up to date
+	enum IndexMode
+	{
+		INDEX_REBUILD,		// The grid is rebuilt by every update
+		INDEX_INCREMENTAL	// Only the boids that have changed cells are moved, and the grid is rebuilt when too many have
+	};
+
+	// What happened to the grid during the last update
+	struct IndexStats
+	{
+		int		m_CellChanges;	// Number of times a boid changed cells
+		int		m_Displaced;	// Number of boids out of their slots at the end of the update (see BoidGrid)
+		bool	m_Rebuilt;		// True if the grid was rebuilt
+	};
+
+	// A reference to a boid that stays valid until the boid is removed, even when its ID changes. A handle to a boid
+	// that has been removed is detected, even after its entry in the flock's table of handles has been reused.
+	struct Handle
+	{
+		int				m_Index;		// Entry in the flock's table of handles
+		unsigned int	m_Generation;	// Generation of the entry when the handle was made (never 0)
+	};
+
+	// A lightweight reference to one boid in the flock, valid in either storage mode
+	class BoidRef
+	{
+	public:
+
+		BoidRef( Flock & flock, int id ) : m_pFlock( &flock ), m_Id( id )	{}
+
+		int			GetId() const									{ return m_Id; }
+		Vector3f	GetPosition() const								{ return m_pFlock->GetPosition( m_Id ); }
+		Vector3f	GetVelocity() const								{ return m_pFlock->GetVelocity( m_Id ); }
+		void		SetPosition( Vector3f const & position )		{ m_pFlock->SetPosition( m_Id, position ); }
+		void		SetVelocity( Vector3f const & velocity )		{ m_pFlock->SetVelocity( m_Id, velocity ); }
+
+	private:
+
+		Flock *	m_pFlock;
+		int		m_Id;
+	};
+
+	Flock( StorageMode storageMode = STORAGE_OBJECTS );
 	virtual ~Flock();
 
 	void Update( float dt, HeightField const & terrain, float xyScale, float seaLevel );
+
+	// Return the storage mode
+	StorageMode			GetStorageMode() const		{ return m_StorageMode; }
+
+	// Set the update mode
+	void				SetUpdateMode( UpdateMode mode )	{ m_UpdateMode = mode; }
+
+	// Return the update mode
+	UpdateMode			GetUpdateMode() const		{ return m_UpdateMode; }
+
+	// Set the number of threads used by UPDATE_DOUBLE_BUFFERED updates. 0 means one per hardware thread.
+	void				SetThreadCount( int nThreads );
+
+	// Return the number of threads used by UPDATE_DOUBLE_BUFFERED updates
+	int					GetThreadCount() const;
+
+	// Boids are identified by IDs, which do not change when the flock reorders its arrays (see SetSortInterval()). The
+	// IDs are 0 through GetCount() - 1. In STORAGE_OBJECTS mode, a boid's ID is its index in the list. When a boid is
+	// removed, the boid with the last ID takes its ID, so that the IDs stay dense. A boid's handle never changes.
+
+	// Add a boid and return its ID. In STORAGE_OBJECTS mode, the boid is allocated from the flock's pool and added to
+	// the end of the list. Boids owned by the caller can also be added to the list directly.
+	int					Add( Vector3f const & position, Vector3f const & velocity );
+
+	// Remove a boid. In STORAGE_OBJECTS mode, a boid allocated by Add() or Spawn() is freed, and a boid added to the
+	// list by the caller is not.
+	void				Remove( int id );
+
+	// Remove all of the boids. The boids allocated by Add() are freed, and boids added to the list by the caller are not.
+	void				RemoveAll();
+
+	// Add a number of boids, and store their handles if handles is not 0
+	void				Spawn( int count, Vector3f const * positions, Vector3f const * velocities, Handle * handles );
+
+	// Remove the boids with the given handles, and return the number removed. Handles to boids that have already been
+	// removed are ignored.
+	int					Despawn( int count, Handle const * handles );
+
+	// Give handles to boids added to the list directly, and free the handles of boids removed from it directly
+	// (STORAGE_OBJECTS only). Update(), Add(), and Remove() do this, so it is only needed to get the handles of boids
+	// added directly before the next update.
+	void				SyncHandles();
+
+	// Return the handle of the boid with the given ID. A boid added to the list directly has no handle until the
+	// handles are synced, and its handle has an index of -1.
+	Handle				GetHandle( int id ) const;
+
+	// Return the ID of the boid with the given handle, or -1 if the boid has been removed
+	int					GetId( Handle handle ) const;
+
+	// Return the number of entries in the table of handles. The index of every handle is less than this.
+	int					GetHandleCapacity() const	{ return int( m_Handles.size() ); }
+
+	// Return the number of boids in the flock
+	int					GetCount() const;
+
+	// Return a reference to a boid
+	BoidRef				GetBoid( int id )			{ return BoidRef( *this, id ); }
+
+	// Per-boid access, by ID
+	Vector3f			GetPosition( int id ) const;
+	Vector3f			GetVelocity( int id ) const;
+	void				SetPosition( int id, Vector3f const & position );
+	void				SetVelocity( int id, Vector3f const & velocity );
+
+	// Return the index in GetArrays() of the boid with the given ID
+	int					GetSlot( int id ) const;
+
+	// Return the ID of the boid at the given index in GetArrays()
+	int					GetId( int slot ) const;
+
+	// The queries use the flock's grid, which is brought up to date by Update() and by the first query after boids are
+	// added, removed, or moved with SetPosition(). Nothing is allocated by a query that finds the grid up to date. In
+	// STORAGE_OBJECTS mode, changes made to the boid objects directly are not seen until the next Update().
+
+	// Find the k boids closest to the position within the given distance and return the number found. The neighbors are
+	// sorted by distance and identified by ID. k is limited to the capacity of the list.
+	int					FindNearest( Vector3f const & position, float maxDistance, int k, NeighborList & neighbors );
+
+	// Find the boids within the given distance of the position, in no particular order, and return the number found. The
+	// neighbors are identified by ID. If the number is more than the capacity of the list, then only the first ones
+	// found are stored.
+	int					FindWithin( Vector3f const & position, float radius, NeighborList & neighbors );
+
+	// Append the IDs of the boids in the cells of the grid that are not entirely outside of the frustum, and return the
+	// number appended. Every boid within margin of the frustum is found, and some others may be.
+	int					FindInFrustum( Frustum const & frustum, float margin, std::vector< int > & ids );
+
+	// Sort the arrays by the positions of the boids along a Z-curve every given number of updates (STORAGE_ARRAYS
+	// only), so that boids that are near each other are stored near each other. 0 means never, and the default is 16.
+	// Sorting changes the order that UPDATE_IN_PLACE updates the boids in, but not their IDs.
+	void				SetSortInterval( int updates )	{ m_SortInterval = updates; }
+
+	// Return the number of updates between sorts, or 0 if the arrays are never sorted
+	int					GetSortInterval() const		{ return m_SortInterval; }
+
+	// Set how the height of the terrain below each boid is found. SAMPLE_NEAREST (the default) uses the nearest point,
+	// and SAMPLE_BILINEAR interpolates, which gives smoother changes in altitude.
+	void				SetTerrainSampling( TerrainCache::Sampling sampling )	{ m_TerrainSampling = sampling; }
+
+	// Return how the height of the terrain below each boid is found
+	TerrainCache::Sampling	GetTerrainSampling() const	{ return m_TerrainSampling; }
+
+	// The terrain is cached by Update() and the cache is rebuilt when the terrain, scale, or sea level changes. Call
+	// this after changing the heights of the terrain.
+	void				InvalidateTerrain()			{ m_TerrainCache.Invalidate(); }
+
+	// Set how the grid used to find neighbors is kept up to date. The results are the same in either mode.
+	void				SetIndexMode( IndexMode mode )	{ m_IndexMode = mode; }
+
+	// Return how the grid used to find neighbors is kept up to date
+	IndexMode			GetIndexMode() const		{ return m_IndexMode; }
+
+	// Set the fraction of the boids that can be out of their slots in the grid before it is rebuilt (INDEX_INCREMENTAL
+	// only). The boids out of their slots are searched one at a time, so a small fraction works best. The default is
+	// .01.
+	void				SetRebuildThreshold( float fraction )	{ m_RebuildThreshold = fraction; }
+
+	// Return the fraction of the boids that can be out of their slots in the grid before it is rebuilt
+	float				GetRebuildThreshold() const	{ return m_RebuildThreshold; }
+
+	// Return what happened to the grid during the last update
+	IndexStats const &	GetIndexStats() const		{ return m_IndexStats; }
+
+	// Set the metric that decides how often each boid is updated (see BoidImportance). A boid that is updated less
+	// often is updated with all of the time since it was last updated. The metric is not owned by the flock, and 0 (the
+	// default) means that every boid is updated every time. The boids that are waiting are updated by the next update
+	// after the metric is removed.
+	void				SetImportance( BoidImportance const * pImportance )	{ m_pImportance = pImportance; }
+
+	// Return the metric that decides how often each boid is updated, or 0 if there is none
+	BoidImportance const *	GetImportance() const	{ return m_pImportance; }
+
+	// Return the number of boids updated by the last update
+	int					GetUpdatedCount() const		{ return m_UpdatedCount; }
+
+	// Return the state of the boids as arrays. In STORAGE_OBJECTS mode, this is a copy that is made by Update(). The
+	// boids are not in ID order if the arrays have been sorted (see GetSlot() and GetId()).
+	BoidArrays const &	GetArrays() const			{ return m_Arrays; }
+
+private:
+
+	class UpdateTask;
+
+	// Prevent copying
+	Flock( Flock const & );
+	Flock & operator =( Flock const & );
+
+	// Copy the state of the boid objects into the arrays (STORAGE_OBJECTS only)
+	void		CopyObjectsToArrays();
+
+	// Make sure that the grid matches the current state of the boids, copying the state of the boid objects first if it
+	// does not (STORAGE_OBJECTS only). Returns true if the grid was rebuilt.
+	bool		RefreshGrid();
+
+	// Move the boids that have changed cells since the grid was last brought up to date
+	void		MoveGrid();
+
+	// Sort the arrays along a Z-curve, keeping the IDs of the boids (STORAGE_ARRAYS only)
+	void		SortBoids();
+
+	// Replace the indexes of the neighbors found by the grid with IDs
+	void		SlotsToIds( NeighborList & neighbors ) const;
+
+	// Return a new handle for the boid with the given ID
+	int			NewHandle( int id );
+
+	// Make a handle invalid and make its entry available for reuse
+	void		FreeHandle( int index );
+
+	// Add the time to the time that the boid at the given index has been waiting, and return true if it is due to be
+	// updated, along with the time to update it by (level of detail only)
+	bool		TakeStep( int slot, float dt, float & step );
+
+	// Update the boids in the range [begin, end) from the current state into the next state
+	void		UpdateRange( int begin, int end,
+							 float dt, HeightField const & terrain, float xyScale, float seaLevel );
+
+	StorageMode		m_StorageMode;
+	UpdateMode		m_UpdateMode;
+	BoidArrays		m_Arrays;		// State of the boids
+	BoidArrays		m_NextArrays;	// Next state of the boids (UPDATE_DOUBLE_BUFFERED only)
+	BoidGrid		m_Grid;			// Used to find the neighbors of each boid
+	BoidPool		m_BoidPool;		// Boid objects allocated by Add() (STORAGE_OBJECTS only)
+	std::vector< bool >	m_IsPooled;	// True if the boid was allocated from the pool, by ID (STORAGE_OBJECTS only)
+	IndexMode		m_IndexMode;
+	float			m_RebuildThreshold;	// Fraction of the boids out of their slots that causes the grid to be rebuilt
+	IndexStats		m_IndexStats;	// What happened to the grid during the last update
+	TerrainCache	m_TerrainCache;	// Heights and water mask of the terrain used by the last update
+	TerrainCache::Sampling	m_TerrainSampling;
+	std::vector< float >	m_TerrainHeights;	// Height of the terrain below each boid at the start of the update
+	WorkerPool *	m_pWorkers;		// Threads used by UPDATE_DOUBLE_BUFFERED updates, or 0 if there is only one
+	bool			m_GridIsCurrent;	// True if the grid matches the current state
+	float			m_WorldSizeX;	// Size of the area covered by the grid, from the terrain in the last update
+	float			m_WorldSizeY;
+	int				m_SortInterval;	// Number of updates between sorts, or 0 for never
+	int				m_UpdatesSinceSort;
+	std::vector< int >	m_SlotOfId;	// Index in the arrays of each boid, by ID (STORAGE_ARRAYS only)
+	std::vector< int >	m_IdOfSlot;	// ID of the boid at each index in the arrays (STORAGE_ARRAYS only)
+	std::vector< int >	m_SortOrder;	// Order of the boids, used when sorting
+	std::vector< int >	m_SortedIds;	// Spare table of IDs by index, used when sorting
+	MortonOrder::Workspace	m_SortWorkspace;	// Memory used when sorting
+
+	// An entry in the table of handles
+	struct HandleEntry
+	{
+		int				m_Id;			// ID of the boid, or -1 if the entry is free
+		unsigned int	m_Generation;	// Incremented when the boid is removed
+	};
+
+	std::vector< HandleEntry >	m_Handles;		// Table of handles
+	std::vector< int >			m_FreeHandles;	// Entries in the table that are free
+	std::vector< int >			m_HandleOfId;	// Entry in the table for each boid, by ID
+
+	// The level of detail of a boid
+	struct LodState
+	{
+		float			m_PendingDt;	// Time since the boid was last updated
+		unsigned char	m_Level;		// Level of detail (see BoidImportance)
+	};
+
+	BoidImportance const *		m_pImportance;	// Decides how often each boid is updated, or 0
+	std::vector< LodState >		m_Lod;			// Level of detail of each boid, by handle, or empty if not used
+	unsigned int				m_Tick;			// Number of updates
+	std::atomic< int >			m_UpdatedCount;	// Number of boids updated by the last update
 };
 
 #endif // !defined( FLOCK_H_INCLUDED )
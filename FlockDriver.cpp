@@ -0,0 +1,621 @@
+/*****************************************************************************
+
+                                FlockDriver.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockDriver.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+// Runs the flock simulation without a window, for profiling and for measuring throughput.
+//
+// For each flock size, a flock is created over the terrain and stepped for a number of ticks at a fixed time step.
+// The program reports ticks per second, the time per boid update, the average number of boids that changed cells in the
+// neighbor grid per tick, the number of times the grid was rebuilt, the average number of boids updated per tick, and
+// the peak resident set size of the process. The time per boid update is the time per tick divided by the number of
+// boids, whether or not they were all updated. If the program is built with FLOCKPROFILE_ENABLED defined, the time in
+// each phase of the update and the counts of the events in the hot paths are reported per tick as well.
+//
+// With -pipeline, the ticks run on a simulation thread (see FramePipeline), which culls the boids against a view of
+// the terrain with the flock's grid as it makes each snapshot, and the main thread consumes the snapshots as a
+// renderer would. The number of snapshots consumed and the average number of boids visible in them are reported as
+// well.
+//
+// Usage: FlockDriver [options] [flock size ...]
+//
+//	-ticks <n>			Number of ticks for each flock size (default 200)
+//	-dt <seconds>		Time step (default 1/60)
+//	-terrain <file>		Load the terrain from a TGA file (default: hf.tga if it can be loaded)
+//	-procedural			Generate the terrain instead of loading it
+//	-double				Use double-buffered updates
+//	-threads <n>		Number of threads, 0 for one per hardware thread (implies -double)
+//	-objects			Store the boids as objects instead of arrays
+//	-clustered			Start the boids in a small box at the center, as in the demo (default: spread out)
+//	-bilinear			Interpolate the height of the terrain below each boid
+//	-rebuild			Rebuild the neighbor grid every tick instead of moving the boids that changed cells
+//	-threshold <f>		Fraction of the boids out of their grid slots that causes the grid to be rebuilt
+//	-sort <n>			Sort the boids along a Z-curve every n ticks, 0 for never (default 16)
+//	-lod-distance <d>	Update boids farther than d from the center of the terrain less often
+//	-lod-neighbors <r>	Update boids with fewer than 4 neighbors within r less often
+//	-trace <file>		Write a timeline of the ticks to a file in the Chrome trace event format
+//	-pipeline			Run the ticks on a simulation thread and consume the snapshots on the main thread
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "TgaFile/TgaFile.h"
+#include "Heightfield/Heightfield.h"
+
+#include "Flock.h"
+#include "BoidImportance.h"
+#include "Scenario.h"
+#include "FlockProfile.h"
+#include "ChromeTrace.h"
+#include "FramePipeline.h"
+#include "BoidCulling.h"
+#include "Frustum.h"
+
+namespace
+{
+
+float const	XY_SCALE		= 1.f;
+float const	Z_SCALE			= 32.f;
+float const	SEA_LEVEL		= Z_SCALE * .25f;
+int const	TERRAIN_SIZE	= 257;		// Size of the procedural terrain
+
+typedef std::chrono::steady_clock	Clock;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Steps a flock for a number of ticks and keeps the statistics of its grid. The snapshots hold the boids that can be
+// seen from a view.
+
+class TickSimulation : public FramePipeline::Simulation
+{
+public:
+
+	TickSimulation( Flock & flock, HeightField const & terrain, float dt, int ticks, Frustum const & view )
+		: m_Flock( flock ),
+		m_Terrain( terrain ),
+		m_View( view ),
+		m_Dt( dt ),
+		m_TicksLeft( ticks ),
+		m_CellChanges( 0 ),
+		m_Rebuilds( 0 ),
+		m_Updates( 0 )
+	{
+	}
+
+	// Step the flock by the fixed time step, whatever the elapsed time
+	virtual bool	Step( float /* elapsed */ )
+	{
+		ChromeTrace::Scope const	trace( "tick" );
+
+		m_Flock.Update( m_Dt, m_Terrain, XY_SCALE, SEA_LEVEL );
+
+		Flock::IndexStats const &	stats	= m_Flock.GetIndexStats();
+
+		m_CellChanges += stats.m_CellChanges;
+		m_Rebuilds += stats.m_Rebuilt ? 1 : 0;
+		m_Updates += m_Flock.GetUpdatedCount();
+
+		return --m_TicksLeft > 0;
+	}
+
+	virtual void	Capture( FrameSnapshot & snapshot )
+	{
+		// The flock is stepped by whole ticks, so there is nothing to draw the boids between
+
+		int const	n	= m_Flock.GetCount();
+
+		snapshot.m_CurrentBoids.Resize( n );
+
+		for ( int id = 0; id < n; id++ )
+		{
+			snapshot.m_CurrentBoids.SetPosition( id, m_Flock.GetPosition( id ) );
+			snapshot.m_CurrentBoids.SetVelocity( id, m_Flock.GetVelocity( id ) );
+		}
+
+		snapshot.m_PreviousBoids = snapshot.m_CurrentBoids;
+		snapshot.m_StepTime = m_Dt;
+		snapshot.m_Alpha = 0.f;
+
+		BoidCulling::Cull( m_Flock, snapshot.m_CurrentBoids, m_View, 1.f, 0.f, snapshot.m_VisibleBoids );
+	}
+
+	long	GetCellChanges() const		{ return m_CellChanges; }
+	int		GetRebuilds() const			{ return m_Rebuilds; }
+	long	GetUpdates() const			{ return m_Updates; }
+
+private:
+
+	// Prevent copying
+	TickSimulation( TickSimulation const & );
+	TickSimulation & operator =( TickSimulation const & );
+
+	Flock &					m_Flock;
+	HeightField const &		m_Terrain;
+	Frustum					m_View;			// The boids that can be seen from here are in the snapshots
+	float					m_Dt;
+	int						m_TicksLeft;
+	long					m_CellChanges;
+	int						m_Rebuilds;
+	long					m_Updates;
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Return the view of a camera at the middle of the south edge of the terrain, looking at the center, as the demo's
+// camera starts out
+
+Frustum TerrainView( HeightField const & terrain )
+{
+	float const	FIELD_OF_VIEW	= 60.f;
+	float const	ASPECT			= 4.f / 3.f;
+	float const	NEAR_DISTANCE	= 1.f;
+	float const	FAR_DISTANCE	= 1000.f;
+
+	// A perspective projection, as made by gluPerspective()
+
+	float const	f	= 1.f / tanf( FIELD_OF_VIEW * .5f * 3.14159265f / 180.f );
+	float		projection[ 16 ]	= { 0.f };
+
+	projection[ 0 ]		= f / ASPECT;
+	projection[ 5 ]		= f;
+	projection[ 10 ]	= ( FAR_DISTANCE + NEAR_DISTANCE ) / ( NEAR_DISTANCE - FAR_DISTANCE );
+	projection[ 11 ]	= -1.f;
+	projection[ 14 ]	= 2.f * FAR_DISTANCE * NEAR_DISTANCE / ( NEAR_DISTANCE - FAR_DISTANCE );
+
+	// The camera looks along +Y and down at the center, with +Z up. Its X axis is +X.
+
+	float const	eyeY	= -terrain.GetSizeY() * XY_SCALE * .5f;
+	float const	eyeZ	= Z_SCALE;
+	float const	length	= sqrtf( eyeY * eyeY + eyeZ * eyeZ );
+	float const	fy		= -eyeY / length;		// Direction of view
+	float const	fz		= -eyeZ / length;
+	float const	uy		= -fz;					// Up is +X cross the direction of view
+	float const	uz		= fy;
+
+	float const	view[ 16 ]	=
+	{
+		1.f,	0.f,	0.f,	0.f,
+		0.f,	uy,		-fy,	0.f,
+		0.f,	uz,		-fz,	0.f,
+		0.f,	-( uy * eyeY + uz * eyeZ ),	fy * eyeY + fz * eyeZ,	1.f
+	};
+
+	return Frustum( projection, view );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Consume the snapshots made by the pipeline until the simulation ends. Returns the number of snapshots consumed, and
+// the total number of visible boids in them.
+
+void Consume( FramePipeline & pipeline, long & frames, long & visible )
+{
+	long	last	= 0;
+
+	frames = 0;
+	visible = 0;
+
+	for ( ;; )
+	{
+		// If the simulation has ended, then the snapshot acquired next is its last one
+
+		bool const					running		= pipeline.IsRunning();
+		FrameSnapshot const * const	pSnapshot	= pipeline.Acquire();
+
+		if ( pSnapshot && pSnapshot->m_Frame != last )
+		{
+			last = pSnapshot->m_Frame;
+			++frames;
+			visible += long( pSnapshot->m_VisibleBoids.size() );
+		}
+		else if ( running )
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Return the peak resident set size of the process in bytes
+
+double PeakRss()
+{
+#if defined( _WIN32 )
+	PROCESS_MEMORY_COUNTERS	counters;
+	GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) );
+	return double( counters.PeakWorkingSetSize );
+#else
+	rusage	usage;
+	getrusage( RUSAGE_SELF, &usage );
+#if defined( __APPLE__ )
+	return double( usage.ru_maxrss );
+#else
+	return double( usage.ru_maxrss ) * 1024.;
+#endif
+#endif
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Print the timers and counters recorded over a number of ticks, per tick
+
+void PrintProfile( FlockProfile::Snapshot const & profile, int ticks )
+{
+	for ( int i = 0; i < FlockProfile::TIMER_COUNT; i++ )
+	{
+		printf( "%24s: %12.3f ms/tick %14.1f calls/tick\n",
+				FlockProfile::GetName( FlockProfile::Timer( i ) ),
+				profile.m_TimerNs[ i ] * 1.e-6 / ticks,
+				double( profile.m_TimerCalls[ i ] ) / ticks );
+	}
+
+	for ( int i = 0; i < FlockProfile::COUNTER_COUNT; i++ )
+	{
+		printf( "%24s: %12.1f /tick\n",
+				FlockProfile::GetName( FlockProfile::Counter( i ) ),
+				double( profile.m_Counts[ i ] ) / ticks );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Usage()
+{
+	fprintf( stderr,
+			 "usage: FlockDriver [-ticks n] [-dt seconds] [-terrain file | -procedural] [-double] [-threads n]\n"
+			 "                   [-objects] [-clustered] [-bilinear] [-rebuild] [-threshold f] [-sort n]\n"
+			 "                   [-lod-distance d | -lod-neighbors r] [-trace file] [-pipeline]\n"
+			 "                   [flock size ...]\n" );
+	exit( 1 );
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int main( int argc, char ** argv )
+{
+	int					ticks			= 200;
+	float				dt				= 1.f / 60.f;
+	std::string			terrainFile		= "hf.tga";
+	bool				procedural		= false;
+	bool				explicitFile	= false;
+	bool				doubleBuffered	= false;
+	int					threads			= 1;
+	bool				objects			= false;
+	bool				clustered		= false;
+	bool				bilinear		= false;
+	bool				rebuild			= false;
+	float				threshold		= -1.f;
+	int					sortInterval	= -1;
+	float				lodDistance		= 0.f;
+	float				lodRadius		= 0.f;
+	std::string			traceFile;
+	bool				pipelined		= false;
+	std::vector< int >	sizes;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		char const * const	arg		= argv[ i ];
+		bool const			more	= ( i + 1 < argc );
+
+		if ( strcmp( arg, "-ticks" ) == 0 && more )
+		{
+			ticks = atoi( argv[ ++i ] );
+		}
+		else if ( strcmp( arg, "-dt" ) == 0 && more )
+		{
+			dt = float( atof( argv[ ++i ] ) );
+		}
+		else if ( strcmp( arg, "-terrain" ) == 0 && more )
+		{
+			terrainFile = argv[ ++i ];
+			explicitFile = true;
+		}
+		else if ( strcmp( arg, "-procedural" ) == 0 )
+		{
+			procedural = true;
+		}
+		else if ( strcmp( arg, "-double" ) == 0 )
+		{
+			doubleBuffered = true;
+		}
+		else if ( strcmp( arg, "-threads" ) == 0 && more )
+		{
+			threads = atoi( argv[ ++i ] );
+			doubleBuffered = true;
+		}
+		else if ( strcmp( arg, "-objects" ) == 0 )
+		{
+			objects = true;
+		}
+		else if ( strcmp( arg, "-clustered" ) == 0 )
+		{
+			clustered = true;
+		}
+		else if ( strcmp( arg, "-bilinear" ) == 0 )
+		{
+			bilinear = true;
+		}
+		else if ( strcmp( arg, "-rebuild" ) == 0 )
+		{
+			rebuild = true;
+		}
+		else if ( strcmp( arg, "-threshold" ) == 0 && more )
+		{
+			threshold = float( atof( argv[ ++i ] ) );
+		}
+		else if ( strcmp( arg, "-sort" ) == 0 && more )
+		{
+			sortInterval = atoi( argv[ ++i ] );
+		}
+		else if ( strcmp( arg, "-lod-distance" ) == 0 && more )
+		{
+			lodDistance = float( atof( argv[ ++i ] ) );
+		}
+		else if ( strcmp( arg, "-lod-neighbors" ) == 0 && more )
+		{
+			lodRadius = float( atof( argv[ ++i ] ) );
+		}
+		else if ( strcmp( arg, "-trace" ) == 0 && more )
+		{
+			traceFile = argv[ ++i ];
+		}
+		else if ( strcmp( arg, "-pipeline" ) == 0 )
+		{
+			pipelined = true;
+		}
+		else if ( arg[ 0 ] != '-' && atoi( arg ) > 0 )
+		{
+			sizes.push_back( atoi( arg ) );
+		}
+		else
+		{
+			Usage();
+		}
+	}
+
+	// Use the flock's default sort interval unless one is given
+
+	if ( sortInterval < 0 )
+	{
+		sortInterval = Flock().GetSortInterval();
+	}
+
+	if ( sizes.empty() )
+	{
+		sizes.push_back( 1000 );
+		sizes.push_back( 10000 );
+		sizes.push_back( 50000 );
+		sizes.push_back( 100000 );
+	}
+
+	// The level of detail metric, if any. The terrain is centered on the origin.
+
+	DistanceImportance		distanceImportance( Vector3f::ORIGIN, lodDistance );
+	NeighborImportance		neighborImportance( lodRadius, 4 );
+	BoidImportance const *	pImportance		= 0;
+	char					lod[ 64 ]		= "none";
+
+	if ( lodDistance > 0.f )
+	{
+		pImportance = &distanceImportance;
+		sprintf( lod, "distance %g", lodDistance );
+	}
+	else if ( lodRadius > 0.f )
+	{
+		pImportance = &neighborImportance;
+		sprintf( lod, "neighbors %g", lodRadius );
+	}
+
+	// Load or generate the terrain
+
+	HeightField *	pTerrain	= 0;
+
+	if ( !procedural )
+	{
+		try
+		{
+			pTerrain = new HeightField( TgaFile( terrainFile.c_str() ), XY_SCALE, Z_SCALE );
+		}
+		catch ( ... )
+		{
+			if ( explicitFile )
+			{
+				fprintf( stderr, "Unable to load terrain from %s\n", terrainFile.c_str() );
+				return 1;
+			}
+		}
+	}
+
+	if ( !pTerrain )
+	{
+		pTerrain = new HeightField( TERRAIN_SIZE, TERRAIN_SIZE, XY_SCALE );
+		Scenario::GenerateTerrain( *pTerrain, Z_SCALE );
+		terrainFile = "procedural";
+	}
+
+	printf( "terrain: %s (%d x %d), ticks: %d, dt: %g, update: %s, threads: %d, storage: %s, start: %s, sampling: %s, "
+			"grid: %s, sort: %d, lod: %s\n",
+			terrainFile.c_str(), pTerrain->GetSizeX(), pTerrain->GetSizeY(), ticks, dt,
+			doubleBuffered ? "double-buffered" : "in place",
+			doubleBuffered ? threads : 1,
+			objects ? "objects" : "arrays",
+			clustered ? "clustered" : "uniform",
+			bilinear ? "bilinear" : "nearest",
+			rebuild ? "rebuild" : "incremental",
+			sortInterval,
+			lod );
+
+	printf( "%10s %12s %14s %16s %15s %10s %14s %14s\n",
+			"boids", "seconds", "ticks/sec", "ns/boid-update", "cell moves/tick", "rebuilds", "updates/tick", "peak RSS MB" );
+
+	if ( !traceFile.empty() && !ChromeTrace::Start( traceFile.c_str() ) )
+	{
+		fprintf( stderr, "Unable to create %s\n", traceFile.c_str() );
+		return 1;
+	}
+
+	for ( std::vector< int >::const_iterator pN = sizes.begin(); pN != sizes.end(); ++pN )
+	{
+		Flock	flock( objects ? Flock::STORAGE_OBJECTS : Flock::STORAGE_ARRAYS );
+
+		if ( doubleBuffered )
+		{
+			flock.SetUpdateMode( Flock::UPDATE_DOUBLE_BUFFERED );
+			flock.SetThreadCount( threads );
+		}
+
+		if ( bilinear )
+		{
+			flock.SetTerrainSampling( TerrainCache::SAMPLE_BILINEAR );
+		}
+
+		if ( rebuild )
+		{
+			flock.SetIndexMode( Flock::INDEX_REBUILD );
+		}
+
+		if ( threshold >= 0.f )
+		{
+			flock.SetRebuildThreshold( threshold );
+		}
+
+		flock.SetSortInterval( sortInterval );
+		flock.SetImportance( pImportance );
+
+		Scenario::SpawnBoids( flock, *pN, clustered ? Scenario::CLUSTERED : Scenario::UNIFORM, *pTerrain, XY_SCALE, 1 );
+
+		// One untimed tick so that the memory used by the update is allocated before timing starts
+
+		flock.Update( dt, *pTerrain, XY_SCALE, SEA_LEVEL );
+
+		TickSimulation			simulation( flock, *pTerrain, dt, ticks, TerrainView( *pTerrain ) );
+		long					frames		= 0;
+		long					visible		= 0;
+		FlockProfile::Snapshot	profileStart;
+
+		FlockProfile::GetSnapshot( profileStart );
+
+		Clock::time_point const	start		= Clock::now();
+
+		if ( pipelined )
+		{
+			FramePipeline	pipeline( simulation, 0.f );
+
+			pipeline.Start();
+			Consume( pipeline, frames, visible );
+			pipeline.Stop();
+		}
+		else
+		{
+			for ( int t = 0; t < ticks; t++ )
+			{
+				simulation.Step( dt );
+			}
+		}
+
+		double const	seconds	= std::chrono::duration< double >( Clock::now() - start ).count();
+
+		FlockProfile::Snapshot	profileEnd;
+
+		FlockProfile::GetSnapshot( profileEnd );
+
+		printf( "%10d %12.3f %14.1f %16.1f %15.1f %10d %14.1f %14.1f\n",
+				*pN,
+				seconds,
+				ticks / seconds,
+				seconds * 1.e9 / ( double( ticks ) * *pN ),
+				double( simulation.GetCellChanges() ) / ticks,
+				simulation.GetRebuilds(),
+				double( simulation.GetUpdates() ) / ticks,
+				PeakRss() / ( 1024. * 1024. ) );
+
+		if ( pipelined )
+		{
+			printf( "%10s pipeline: %ld of %d snapshots consumed, %.1f boids visible per snapshot\n",
+					"", frames, ticks, frames > 0 ? double( visible ) / frames : 0. );
+		}
+
+		if ( FlockProfile::IsEnabled() )
+		{
+			FlockProfile::Snapshot	profile;
+
+			FlockProfile::Difference( profileEnd, profileStart, profile );
+			PrintProfile( profile, ticks );
+		}
+
+		fflush( stdout );
+
+		Scenario::DeleteBoids( flock );
+	}
+
+	if ( ChromeTrace::IsActive() )
+	{
+		ChromeTrace::Stop();
+
+		if ( ChromeTrace::GetDroppedCount() > 0 )
+		{
+			fprintf( stderr, "%d trace events were dropped\n", ChromeTrace::GetDroppedCount() );
+		}
+	}
+
+	delete pTerrain;
+
+	return 0;
+}
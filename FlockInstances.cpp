@@ -0,0 +1,241 @@
+/*****************************************************************************
+
+                               FlockInstances.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockInstances.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "FlockInstances.h"
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include "Math/Vector3f.h"
+#include "WorkerPool.h"
+
+#include "Flock.h"
+#include "FlockScheduler.h"
+
+namespace
+{
+
+// Number of boids handed to a thread at a time
+int const	INSTANCES_PER_CHUNK	= 1024;
+
+// Squared lengths below this are treated as 0
+float const	MIN_LENGTH_SQUARED	= 1.e-12f;
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Packs a range of boids on one of the threads
+
+class FlockInstances::PackTask : public WorkerPool::Task
+{
+public:
+
+	PackTask( FlockInstances & instances, BoidArrays const & boids ) : m_Instances( instances ), m_Boids( boids )	{}
+
+	virtual void Execute( int begin, int end )
+	{
+		m_Instances.PackRange( m_Boids, begin, end );
+	}
+
+private:
+
+	// Prevent assignment
+	PackTask & operator =( PackTask const & );
+
+	FlockInstances &	m_Instances;
+	BoidArrays const &	m_Boids;
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FlockInstances::FlockInstances()
+	: m_pWorkers( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FlockInstances::~FlockInstances()
+{
+	delete m_pWorkers;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockInstances::Build( Flock const & flock, FlockScheduler const & scheduler, float alpha )
+{
+	int const	n	= flock.GetCount();
+
+	m_Boids.Resize( n );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		m_Boids.SetPosition( i, scheduler.GetInterpolatedPosition( i, alpha ) );
+		m_Boids.SetVelocity( i, flock.GetVelocity( i ) );
+	}
+
+	Pack( m_Boids );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockInstances::Build( Flock const & flock )
+{
+	int const	n	= flock.GetCount();
+
+	m_Boids.Resize( n );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		m_Boids.SetPosition( i, flock.GetPosition( i ) );
+		m_Boids.SetVelocity( i, flock.GetVelocity( i ) );
+	}
+
+	Pack( m_Boids );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockInstances::Pack( BoidArrays const & boids )
+{
+	int const	n	= boids.Size();
+
+	m_Instances.resize( n );
+
+	if ( n == 0 )
+	{
+		return;
+	}
+
+	if ( m_pWorkers && n > INSTANCES_PER_CHUNK )
+	{
+		PackTask	task( *this, boids );
+
+		m_pWorkers->Run( task, n, INSTANCES_PER_CHUNK );
+	}
+	else
+	{
+		PackRange( boids, 0, n );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockInstances::SetThreadCount( int nThreads )
+{
+	if ( nThreads <= 0 )
+	{
+		nThreads = std::max( int( std::thread::hardware_concurrency() ), 1 );
+	}
+
+	if ( nThreads == GetThreadCount() )
+	{
+		return;
+	}
+
+	delete m_pWorkers;
+	m_pWorkers = ( nThreads > 1 ) ? new WorkerPool( nThreads ) : 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int FlockInstances::GetThreadCount() const
+{
+	return m_pWorkers ? m_pWorkers->GetThreadCount() : 1;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockInstances::PackRange( BoidArrays const & boids, int begin, int end )
+{
+	float const * const	pX		= &boids.m_X[ 0 ];
+	float const * const	pY		= &boids.m_Y[ 0 ];
+	float const * const	pZ		= &boids.m_Z[ 0 ];
+	float const * const	pVX		= &boids.m_VX[ 0 ];
+	float const * const	pVY		= &boids.m_VY[ 0 ];
+	float const * const	pVZ		= &boids.m_VZ[ 0 ];
+	Instance * const	pOut	= &m_Instances[ 0 ];
+
+	// The special cases are handled by selecting between values instead of branching, so every boid takes the same path
+
+	for ( int i = begin; i < end; i++ )
+	{
+		// Forward is the direction of the velocity, or +X if the boid is not moving
+
+		float const	speed2		= pVX[ i ] * pVX[ i ] + pVY[ i ] * pVY[ i ] + pVZ[ i ] * pVZ[ i ];
+		bool const	moving		= ( speed2 > MIN_LENGTH_SQUARED );
+		float const	invSpeed	= 1.f / sqrtf( std::max( speed2, MIN_LENGTH_SQUARED ) );
+		float const	fx			= moving ? pVX[ i ] * invSpeed : 1.f;
+		float const	fy			= moving ? pVY[ i ] * invSpeed : 0.f;
+		float const	fz			= moving ? pVZ[ i ] * invSpeed : 0.f;
+
+		// The side is forward x Z, or +Y if forward is straight up or down
+
+		float const	side2		= fx * fx + fy * fy;
+		bool const	level		= ( side2 > MIN_LENGTH_SQUARED );
+		float const	invSide		= 1.f / sqrtf( std::max( side2, MIN_LENGTH_SQUARED ) );
+		float const	sx			= level ? fy * invSide : 0.f;
+		float const	sy			= level ? -fx * invSide : 1.f;
+
+		// The top is side x forward (the side has no Z component)
+
+		float const	ux			= sy * fz;
+		float const	uy			= -sx * fz;
+		float const	uz			= sx * fy - sy * fx;
+
+		// The model's X axis is the side, Y is the top, and -Z is forward
+
+		float * const	m	= pOut[ i ].m_Matrix;
+
+		m[  0 ] = sx;		m[  4 ] = ux;		m[  8 ] = -fx;		m[ 12 ] = pX[ i ];
+		m[  1 ] = sy;		m[  5 ] = uy;		m[  9 ] = -fy;		m[ 13 ] = pY[ i ];
+		m[  2 ] = 0.f;		m[  6 ] = uz;		m[ 10 ] = -fz;		m[ 14 ] = pZ[ i ];
+		m[  3 ] = 0.f;		m[  7 ] = 0.f;		m[ 11 ] = 0.f;		m[ 15 ] = 1.f;
+	}
+}
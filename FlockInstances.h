@@ -0,0 +1,97 @@
+#if !defined( FLOCKINSTANCES_H_INCLUDED )
+#define FLOCKINSTANCES_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                FlockInstances.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockInstances.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include "BoidArrays.h"
+
+class Flock;
+class FlockScheduler;
+class WorkerPool;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The transforms of the boids in a flock, packed into one contiguous array for drawing.
+//
+// Each boid's transform places the model at the boid's position and turns it to face along the boid's velocity, with
+// its top toward +Z (up from the terrain) as far as possible. The model is expected to point down its -Z axis with its
+// top toward +Y. A boid that is not moving faces +X, and a boid moving straight up or down has +Y as its side.
+//
+// The transforms are 4x4 matrices in column-major order, so each one can be handed to glMultMatrixf() as it is, or
+// the whole array can be used as a per-instance attribute buffer. The boids are read from separate arrays for each
+// component and every boid is packed the same way with no branches, so the loop can be vectorized, and it only writes
+// to the instance array, so it can run on any thread (or on several, see SetThreadCount()).
+
+class FlockInstances
+{
+public:
+
+	// The transform of one boid
+	struct Instance
+	{
+		float	m_Matrix[ 16 ];		// Column-major
+	};
+
+	FlockInstances();
+	virtual ~FlockInstances();
+
+	// Pack the boids at the time of the frame: their positions interpolated by the scheduler, and their current
+	// velocities. The instances are in ID order.
+	void				Build( Flock const & flock, FlockScheduler const & scheduler, float alpha );
+
+	// Pack the boids at their current positions, in ID order
+	void				Build( Flock const & flock );
+
+	// Pack the boids in the arrays, in the same order
+	void				Pack( BoidArrays const & boids );
+
+	// Set the number of threads that pack the boids. 0 means one per hardware thread. The default is 1.
+	void				SetThreadCount( int nThreads );
+
+	// Return the number of threads that pack the boids
+	int					GetThreadCount() const;
+
+	// Return the instances
+	Instance const *	GetInstances() const		{ return m_Instances.empty() ? 0 : &m_Instances[ 0 ]; }
+
+	// Return the number of instances
+	int					GetCount() const			{ return int( m_Instances.size() ); }
+
+	// Return the boids packed by the last call to Build(), in ID order
+	BoidArrays const &	GetBoids() const			{ return m_Boids; }
+
+private:
+
+	class PackTask;
+
+	// Prevent copying
+	FlockInstances( FlockInstances const & );
+	FlockInstances & operator =( FlockInstances const & );
+
+	// Pack the boids in the range [begin, end)
+	void	PackRange( BoidArrays const & boids, int begin, int end );
+
+	std::vector< Instance >	m_Instances;
+	BoidArrays				m_Boids;		// The boids gathered by Build()
+	WorkerPool *			m_pWorkers;		// Threads that pack the boids, or 0 if there is only one
+};
+
+
+#endif // !defined( FLOCKINSTANCES_H_INCLUDED )
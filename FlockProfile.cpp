@@ -0,0 +1,206 @@
+/*****************************************************************************
+
+                                FlockProfile.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockProfile.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "FlockProfile.h"
+
+#include <vector>
+#include <mutex>
+#include <new>
+#include <cstdint>
+
+namespace
+{
+
+// The buffers of all of the threads that have recorded something
+struct Registry
+{
+	std::mutex								m_Mutex;
+	std::vector< FlockProfile::Buffer * >	m_Buffers;
+};
+
+
+// Return the registry. It is never destroyed, because threads may still be recording while static objects are being
+// destroyed.
+
+Registry & GetRegistry()
+{
+	static Registry * const	pRegistry	= new Registry;
+
+	return *pRegistry;
+}
+
+
+char const * const	TIMER_NAMES[ FlockProfile::TIMER_COUNT ] =
+{
+	"flock update",
+	"grid",
+	"terrain",
+	"boids",
+	"neighbor query"
+};
+
+char const * const	COUNTER_NAMES[ FlockProfile::COUNTER_COUNT ] =
+{
+	"boid updates",
+	"neighbor queries",
+	"neighbor candidates",
+	"terrain samples",
+	"water bounces",
+	"wraps"
+};
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool FlockProfile::IsEnabled()
+{
+#if defined( FLOCKPROFILE_ENABLED )
+	return true;
+#else // defined( FLOCKPROFILE_ENABLED )
+	return false;
+#endif // defined( FLOCKPROFILE_ENABLED )
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FlockProfile::Buffer & FlockProfile::GetBuffer()
+{
+	static thread_local Buffer *	s_pBuffer	= 0;
+
+	// The registry is only locked the first time a thread records something
+
+	if ( !s_pBuffer )
+	{
+		// new does not have to honor the alignment of the buffer, so the memory is aligned here. The buffers are
+		// never freed, because other threads may still read them.
+
+		char * const	pMemory	= new char[ sizeof( Buffer ) + alignof( Buffer ) - 1 ];
+		if ( !pMemory ) throw std::bad_alloc();
+
+		std::uintptr_t const	mask	= alignof( Buffer ) - 1;
+		std::uintptr_t const	aligned	= ( reinterpret_cast< std::uintptr_t >( pMemory ) + mask ) & ~mask;
+		Buffer * const			pBuffer	= new ( reinterpret_cast< void * >( aligned ) ) Buffer;
+
+		for ( int i = 0; i < TIMER_COUNT; i++ )
+		{
+			pBuffer->m_TimerNs[ i ] = 0;
+			pBuffer->m_TimerCalls[ i ] = 0;
+		}
+
+		for ( int i = 0; i < COUNTER_COUNT; i++ )
+		{
+			pBuffer->m_Counts[ i ] = 0;
+		}
+
+		Registry &	registry	= GetRegistry();
+
+		std::lock_guard< std::mutex >	lock( registry.m_Mutex );
+
+		registry.m_Buffers.push_back( pBuffer );
+		s_pBuffer = pBuffer;
+	}
+
+	return *s_pBuffer;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockProfile::GetSnapshot( Snapshot & snapshot )
+{
+	for ( int i = 0; i < TIMER_COUNT; i++ )
+	{
+		snapshot.m_TimerNs[ i ] = 0;
+		snapshot.m_TimerCalls[ i ] = 0;
+	}
+
+	for ( int i = 0; i < COUNTER_COUNT; i++ )
+	{
+		snapshot.m_Counts[ i ] = 0;
+	}
+
+	Registry &	registry	= GetRegistry();
+
+	std::lock_guard< std::mutex >	lock( registry.m_Mutex );
+
+	for ( std::vector< Buffer * >::const_iterator ppBuffer = registry.m_Buffers.begin();
+		  ppBuffer != registry.m_Buffers.end();
+		  ++ppBuffer )
+	{
+		Buffer const &	buffer	= **ppBuffer;
+
+		for ( int i = 0; i < TIMER_COUNT; i++ )
+		{
+			snapshot.m_TimerNs[ i ] += buffer.m_TimerNs[ i ].load( std::memory_order_relaxed );
+			snapshot.m_TimerCalls[ i ] += buffer.m_TimerCalls[ i ].load( std::memory_order_relaxed );
+		}
+
+		for ( int i = 0; i < COUNTER_COUNT; i++ )
+		{
+			snapshot.m_Counts[ i ] += buffer.m_Counts[ i ].load( std::memory_order_relaxed );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockProfile::Difference( Snapshot const & later, Snapshot const & earlier, Snapshot & difference )
+{
+	for ( int i = 0; i < TIMER_COUNT; i++ )
+	{
+		difference.m_TimerNs[ i ] = later.m_TimerNs[ i ] - earlier.m_TimerNs[ i ];
+		difference.m_TimerCalls[ i ] = later.m_TimerCalls[ i ] - earlier.m_TimerCalls[ i ];
+	}
+
+	for ( int i = 0; i < COUNTER_COUNT; i++ )
+	{
+		difference.m_Counts[ i ] = later.m_Counts[ i ] - earlier.m_Counts[ i ];
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+char const * FlockProfile::GetName( Timer timer )
+{
+	return TIMER_NAMES[ timer ];
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+char const * FlockProfile::GetName( Counter counter )
+{
+	return COUNTER_NAMES[ counter ];
+}
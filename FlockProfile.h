@@ -0,0 +1,171 @@
+#if !defined( FLOCKPROFILE_H_INCLUDED )
+#define FLOCKPROFILE_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                 FlockProfile.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockProfile.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include "ChromeTrace.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Timers and counters for the hot paths of the simulation.
+//
+// The timers and counters are only compiled in if FLOCKPROFILE_ENABLED is defined. Otherwise, FLOCKPROFILE_SCOPE and
+// FLOCKPROFILE_COUNT expand to nothing and cost nothing, and the snapshots are all zero. FLOCKPROFILE_TRACE_SCOPE also
+// records the scope in the trace (see ChromeTrace), which is compiled in either way.
+//
+// Each thread adds to its own buffer, so the hot paths take no locks and share no cache lines. A buffer is created
+// the first time a thread records something, and it is kept until the program exits, so the totals never go down.
+// GetSnapshot() adds up the buffers of all of the threads, and can be called at any time by any thread.
+
+namespace FlockProfile
+{
+
+// Timers
+enum Timer
+{
+	TIMER_FLOCK_UPDATE,		// Flock::Update()
+	TIMER_GRID,				// Sorting the boids and bringing the grid up to date
+	TIMER_TERRAIN,			// Refreshing the terrain cache and sampling the heights below the boids
+	TIMER_BOIDS,			// Updating the boids
+	TIMER_NEIGHBOR_QUERY,	// Finding the closest neighbor of a boid
+
+	TIMER_COUNT
+};
+
+// Counters
+enum Counter
+{
+	COUNTER_BOID_UPDATES,			// Calls to Boid::Update()
+	COUNTER_NEIGHBOR_QUERIES,		// Searches for the closest neighbor of a boid
+	COUNTER_NEIGHBOR_CANDIDATES,	// Boids whose distances were measured by the searches
+	COUNTER_TERRAIN_SAMPLES,		// Heights of the terrain sampled below boids
+	COUNTER_WATER_BOUNCES,			// Times a boid was turned back because it was over water
+	COUNTER_WRAPS,					// Times a boid crossed an edge of the terrain and was wrapped to the other side
+
+	COUNTER_COUNT
+};
+
+// The totals of the timers and counters of all threads since the program started
+struct Snapshot
+{
+	long long	m_TimerNs[ TIMER_COUNT ];		// Total time in each timer, in nanoseconds
+	long long	m_TimerCalls[ TIMER_COUNT ];	// Number of times each timer was started
+	long long	m_Counts[ COUNTER_COUNT ];		// Total of each counter
+};
+
+// The timers and counters of one thread. The buffers of different threads are in separate cache lines.
+struct alignas( 64 ) Buffer
+{
+	// Only the owning thread writes, so an update is a load and a store rather than a locked add. The values are
+	// atomic only so that other threads can read them while they change.
+	std::atomic< long long >	m_TimerNs[ TIMER_COUNT ];
+	std::atomic< long long >	m_TimerCalls[ TIMER_COUNT ];
+	std::atomic< long long >	m_Counts[ COUNTER_COUNT ];
+
+	void	Add( std::atomic< long long > & value, long long n )
+	{
+		value.store( value.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+	}
+};
+
+// Return true if the timers and counters are compiled in
+bool			IsEnabled();
+
+// Return the totals of all threads
+void			GetSnapshot( Snapshot & snapshot );
+
+// Compute the change from one snapshot to a later one
+void			Difference( Snapshot const & later, Snapshot const & earlier, Snapshot & difference );
+
+// Return the name of a timer or a counter, for reports
+char const *	GetName( Timer timer );
+char const *	GetName( Counter counter );
+
+// Return the buffer of the calling thread, creating it if necessary
+Buffer &		GetBuffer();
+
+// Adds the time from its construction to its destruction to a timer
+class ScopedTimer
+{
+public:
+
+	explicit ScopedTimer( Timer timer )
+		: m_Timer( timer ),
+		m_Start( std::chrono::steady_clock::now() )
+	{
+	}
+
+	~ScopedTimer()
+	{
+		Buffer &	buffer	= GetBuffer();
+
+		std::chrono::steady_clock::duration const	elapsed	= std::chrono::steady_clock::now() - m_Start;
+		long long const								ns		=
+			std::chrono::duration_cast< std::chrono::nanoseconds >( elapsed ).count();
+
+		buffer.Add( buffer.m_TimerNs[ m_Timer ], ns );
+		buffer.Add( buffer.m_TimerCalls[ m_Timer ], 1 );
+	}
+
+private:
+
+	// Prevent copying
+	ScopedTimer( ScopedTimer const & );
+	ScopedTimer & operator =( ScopedTimer const & );
+
+	Timer									m_Timer;
+	std::chrono::steady_clock::time_point	m_Start;
+};
+
+} // namespace FlockProfile
+
+
+#define FLOCKPROFILE_JOIN2( a, b )			a ## b
+#define FLOCKPROFILE_JOIN( a, b )			FLOCKPROFILE_JOIN2( a, b )
+
+// Time the rest of the enclosing scope, and record it in the trace under the given name
+#define FLOCKPROFILE_TRACE_SCOPE( timer, name )																	\
+	FLOCKPROFILE_SCOPE( timer );																				\
+	ChromeTrace::Scope const	FLOCKPROFILE_JOIN( flockProfileTrace, __LINE__ )( name )
+
+#if defined( FLOCKPROFILE_ENABLED )
+
+// Time the rest of the enclosing scope
+#define FLOCKPROFILE_SCOPE( timer )																				\
+	FlockProfile::ScopedTimer const	FLOCKPROFILE_JOIN( flockProfileTimer, __LINE__ )( FlockProfile::timer )
+
+// Add n to a counter
+#define FLOCKPROFILE_COUNT( counter, n )																		\
+	do																											\
+	{																											\
+		FlockProfile::Buffer &	flockProfileBuffer	= FlockProfile::GetBuffer();								\
+		flockProfileBuffer.Add( flockProfileBuffer.m_Counts[ FlockProfile::counter ], ( n ) );					\
+	} while ( false )
+
+#else // defined( FLOCKPROFILE_ENABLED )
+
+#define FLOCKPROFILE_SCOPE( timer )
+#define FLOCKPROFILE_COUNT( counter, n )	do {} while ( false )
+
+#endif // defined( FLOCKPROFILE_ENABLED )
+
+
+#endif // !defined( FLOCKPROFILE_H_INCLUDED )
@@ -0,0 +1,234 @@
+/*****************************************************************************
+
+                              FlockScheduler.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockScheduler.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "FlockScheduler.h"
+
+#include <cassert>
+#include <cmath>
+#include "Math/Vector3f.h"
+#include "Heightfield/Heightfield.h"
+
+#include "Flock.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FlockScheduler::FlockScheduler( Flock & flock, float stepsPerSecond, int maxStepsPerFrame )
+	: m_Flock( flock ),
+	m_StepTime( 1.f / stepsPerSecond ),
+	m_MaxStepsPerFrame( maxStepsPerFrame ),
+	m_Accumulator( 0. ),
+	m_StepCount( 0 ),
+	m_DroppedStepCount( 0 ),
+	m_WorldSizeX( 0.f ),
+	m_WorldSizeY( 0.f )
+{
+	assert( stepsPerSecond > 0.f );
+	assert( maxStepsPerFrame > 0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FlockScheduler::~FlockScheduler()
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int FlockScheduler::Advance( float elapsed, HeightField const & terrain, float xyScale, float seaLevel )
+{
+	m_WorldSizeX = ( terrain.GetSizeX() - 1.f ) * xyScale;
+	m_WorldSizeY = ( terrain.GetSizeY() - 1.f ) * xyScale;
+
+	if ( elapsed > 0.f )
+	{
+		m_Accumulator += elapsed;
+	}
+
+	int	steps	= 0;
+
+	while ( m_Accumulator >= m_StepTime && steps < m_MaxStepsPerFrame )
+	{
+		m_Flock.Update( m_StepTime, terrain, xyScale, seaLevel );
+
+		// The flock's arrays may be reordered by the update, so the state is copied by handle
+
+		m_Previous.Swap( m_Current );
+		m_PreviousGenerations.swap( m_CurrentGenerations );
+		CopyState( m_Current, m_CurrentGenerations );
+
+		m_Accumulator -= m_StepTime;
+		++steps;
+	}
+
+	m_StepCount += steps;
+
+	// Drop the whole steps that could not be taken, but keep the fraction so that the interpolation stays smooth
+
+	if ( m_Accumulator >= m_StepTime )
+	{
+		double const	dropped	= floor( m_Accumulator / m_StepTime );
+
+		m_DroppedStepCount += long( dropped );
+		m_Accumulator -= dropped * m_StepTime;
+	}
+
+	return steps;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockScheduler::Reset()
+{
+	m_Accumulator = 0.;
+	Capture();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockScheduler::SetStepRate( float stepsPerSecond )
+{
+	assert( stepsPerSecond > 0.f );
+
+	// Keep the same fraction of a step in the accumulator
+
+	float const	alpha	= GetAlpha();
+
+	m_StepTime = 1.f / stepsPerSecond;
+	m_Accumulator = alpha * m_StepTime;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockScheduler::SetMaxStepsPerFrame( int maxSteps )
+{
+	assert( maxSteps > 0 );
+
+	m_MaxStepsPerFrame = maxSteps;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float FlockScheduler::GetAlpha() const
+{
+	float const	alpha	= float( m_Accumulator / m_StepTime );
+
+	return ( alpha < 1.f ) ? alpha : 1.f;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Vector3f FlockScheduler::GetInterpolatedPosition( int id, float alpha ) const
+{
+	Flock::Handle const	handle	= m_Flock.GetHandle( id );
+	int const			i		= handle.m_Index;
+
+	// If there is no saved state for the boid yet, then its position is the only one there is
+
+	if ( i < 0 || i >= m_Current.Size() || m_CurrentGenerations[ i ] != handle.m_Generation )
+	{
+		return m_Flock.GetPosition( id );
+	}
+
+	Vector3f const	current		= m_Current.GetPosition( i );
+
+	// If the boid was added by the last step, then there is nothing to interpolate from
+
+	if ( i >= m_Previous.Size() || m_PreviousGenerations[ i ] != handle.m_Generation )
+	{
+		return current;
+	}
+
+	Vector3f const	previous	= m_Previous.GetPosition( i );
+	Vector3f const	change		= current - previous;
+
+	// A boid that moved more than half way across the terrain in one step wrapped around the edge, and interpolating
+	// would draw it crossing the whole terrain
+
+	if ( fabs( change.m_X ) > m_WorldSizeX * .5f || fabs( change.m_Y ) > m_WorldSizeY * .5f )
+	{
+		return current;
+	}
+
+	return previous + change * alpha;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockScheduler::Capture()
+{
+	// Boids may have been added to the list directly since the last update
+
+	m_Flock.SyncHandles();
+
+	CopyState( m_Current, m_CurrentGenerations );
+	m_Previous = m_Current;
+	m_PreviousGenerations = m_CurrentGenerations;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FlockScheduler::CopyState( BoidArrays & state, std::vector< unsigned int > & generations ) const
+{
+	int const	n	= m_Flock.GetCount();
+
+	state.Resize( m_Flock.GetHandleCapacity() );
+	generations.assign( m_Flock.GetHandleCapacity(), 0 );
+
+	for ( int id = 0; id < n; id++ )
+	{
+		Flock::Handle const	handle	= m_Flock.GetHandle( id );
+
+		state.SetPosition( handle.m_Index, m_Flock.GetPosition( id ) );
+		state.SetVelocity( handle.m_Index, m_Flock.GetVelocity( id ) );
+		generations[ handle.m_Index ] = handle.m_Generation;
+	}
+}
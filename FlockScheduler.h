@@ -0,0 +1,119 @@
+#if !defined( FLOCKSCHEDULER_H_INCLUDED )
+#define FLOCKSCHEDULER_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                               FlockScheduler.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockScheduler.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include "Math/Vector3f.h"
+#include "BoidArrays.h"
+
+class Flock;
+class HeightField;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Steps a flock at a fixed rate, independent of the frame rate.
+//
+// The elapsed time of each frame is added to an accumulator, and the flock is stepped once for each whole step in the
+// accumulator, up to a limit per frame. Time beyond the limit is dropped, so a long frame slows the simulation down
+// instead of making the next frames longer. The state of the flock before and after the last step is kept, so that
+// the boids can be drawn part way between them. The states are saved by handle (see Flock::Handle), so boids can be
+// added and removed between steps.
+
+class FlockScheduler
+{
+public:
+
+	FlockScheduler( Flock & flock, float stepsPerSecond = 60.f, int maxStepsPerFrame = 4 );
+	virtual ~FlockScheduler();
+
+	// Add the elapsed time to the accumulator and step the flock. Returns the number of steps taken.
+	int					Advance( float elapsed, HeightField const & terrain, float xyScale, float seaLevel );
+
+	// Discard the accumulated time and the saved states (for example, after boids have been moved)
+	void				Reset();
+
+	// Set the number of steps per second
+	void				SetStepRate( float stepsPerSecond );
+
+	// Return the number of steps per second
+	float				GetStepRate() const				{ return 1.f / m_StepTime; }
+
+	// Return the length of a step in seconds
+	float				GetStepTime() const				{ return m_StepTime; }
+
+	// Set the maximum number of steps taken by a call to Advance()
+	void				SetMaxStepsPerFrame( int maxSteps );
+
+	// Return the maximum number of steps taken by a call to Advance()
+	int					GetMaxStepsPerFrame() const		{ return m_MaxStepsPerFrame; }
+
+	// Return the total number of steps taken
+	long				GetStepCount() const			{ return m_StepCount; }
+
+	// Return the total number of steps dropped because of the limit per frame
+	long				GetDroppedStepCount() const		{ return m_DroppedStepCount; }
+
+	// Return the fraction of a step remaining in the accumulator, in [0, 1). This is how far the time of the frame is
+	// past the current state.
+	float				GetAlpha() const;
+
+	// Return the state before the last step, indexed by the index of each boid's handle. The entries for handles that
+	// were not in use are not defined.
+	BoidArrays const &	GetPreviousState() const		{ return m_Previous; }
+
+	// Return the state after the last step, indexed by the index of each boid's handle
+	BoidArrays const &	GetCurrentState() const			{ return m_Current; }
+
+	// Return the position of a boid (by ID) interpolated between the previous and current states by alpha. A boid that
+	// wrapped around the edge of the terrain in the last step is not interpolated, and a boid that was added since
+	// then is where it is now.
+	Vector3f			GetInterpolatedPosition( int id, float alpha ) const;
+
+	// Return the position of a boid at the time of the frame
+	Vector3f			GetInterpolatedPosition( int id ) const	{ return GetInterpolatedPosition( id, GetAlpha() ); }
+
+private:
+
+	// Prevent copying
+	FlockScheduler( FlockScheduler const & );
+	FlockScheduler & operator =( FlockScheduler const & );
+
+	// Save the state of the flock as both the previous and current states
+	void		Capture();
+
+	// Copy the state of the flock, indexed by the index of each boid's handle, and the generation of each handle
+	void		CopyState( BoidArrays & state, std::vector< unsigned int > & generations ) const;
+
+	Flock &		m_Flock;
+	float		m_StepTime;				// Length of a step in seconds
+	int			m_MaxStepsPerFrame;
+	double		m_Accumulator;			// Time not yet simulated
+	long		m_StepCount;
+	long		m_DroppedStepCount;
+	float		m_WorldSizeX;			// Size of the terrain in the last step
+	float		m_WorldSizeY;
+	BoidArrays	m_Previous;				// State before the last step, by handle index
+	BoidArrays	m_Current;				// State after the last step, by handle index
+	std::vector< unsigned int >	m_PreviousGenerations;	// Generation of the handle of each boid in m_Previous, or 0
+	std::vector< unsigned int >	m_CurrentGenerations;	// Generation of the handle of each boid in m_Current, or 0
+};
+
+
+#endif // !defined( FLOCKSCHEDULER_H_INCLUDED )
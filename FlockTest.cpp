@@ -0,0 +1,1787 @@
+/*****************************************************************************
+
+                                 FlockTest.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FlockTest.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+// Checks the optimized paths of the simulation against the simple paths that they replace, and the containers that
+// replace the heap against what they promise.
+//
+// Each test builds its worlds from fixed seeds, runs the optimized path and the reference path over them, and reports
+// the number of results that do not match. The results must match exactly. The program returns 0 if every test
+// passes.
+//
+// Usage: FlockTest [-filter text]
+//
+//	-filter <text>		Only run the tests with names containing the text
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Misc/Random.h"
+#include "Math/Vector3f.h"
+#include "Heightfield/Heightfield.h"
+
+#include "Boid.h"
+#include "BoidArrays.h"
+#include "BoidCulling.h"
+#include "BoidGrid.h"
+#include "BoidImportance.h"
+#include "BoidPool.h"
+#include "Flock.h"
+#include "Frustum.h"
+#include "HeightFieldMesh.h"
+#include "NeighborKernel.h"
+#include "NeighborList.h"
+#include "Scenario.h"
+#include "TerrainCache.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Calls the private parts of a boid. This class is a friend of Boid.
+
+class FlockTest
+{
+public:
+
+	// Search the whole flock for the closest boid, as Boid::Update does without a grid
+	static int	FindClosest( Boid const & boid, BoidArrays const & boids, float sizeX, float sizeY )
+	{
+		return boid.FindClosest( boids, 0, sizeX, sizeY );
+	}
+};
+
+
+namespace
+{
+
+int const	TERRAIN_SIZE	= 257;
+float const	XY_SCALE		= 1.f;
+float const	Z_SCALE			= 32.f;
+
+// Size of the area covered by the terrain
+float const	WORLD_SIZE		= ( TERRAIN_SIZE - 1 ) * XY_SCALE;
+
+// Size given to the brute-force search so that it never looks across the edges
+float const	NO_WRAP			= std::numeric_limits< float >::infinity();
+
+// Capacity of the neighbor lists, which is more than any query finds
+int const	MAX_NEIGHBORS	= 4096;
+
+// A neighbor found by the brute-force search, ordered by distance and then by index
+struct Neighbor
+{
+	float	m_Distance2;
+	int		m_Index;
+
+	bool operator <( Neighbor const & b ) const
+	{
+		return m_Distance2 < b.m_Distance2 || ( m_Distance2 == b.m_Distance2 && m_Index < b.m_Index );
+	}
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Move some of the boids by up to a cell, so that some of them change cells, and tell the grid. The grid is then kept
+// up to date incrementally, as Flock does between rebuilds. The boids stay on the terrain, as Boid::Wrap keeps them.
+
+void MoveSome( BoidArrays & boids, BoidGrid & grid, RandomFloat & random )
+{
+	for ( int i = 0; i < boids.Size(); i += 7 )
+	{
+		float const		d			= Boid::MAX_PERCEPTION_DISTANCE;
+		float const		half		= WORLD_SIZE * .5f;
+		Vector3f const	offset( random.Next( -d, d ), random.Next( -d, d ), 0.f );
+		Vector3f		position	= boids.GetPosition( i ) + offset;
+
+		if ( position.m_X < -half )		position.m_X += WORLD_SIZE;
+		else if ( position.m_X > half )	position.m_X -= WORLD_SIZE;
+		if ( position.m_Y < -half )		position.m_Y += WORLD_SIZE;
+		else if ( position.m_Y > half )	position.m_Y -= WORLD_SIZE;
+
+		boids.SetPosition( i, position );
+		grid.Move( i, position );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Return the squared distance from a position to the nearest image of a boid on a terrain of the given size. The
+// images are chosen in the same way as in Boid's brute-force search, so the distances are exactly the same.
+
+float Distance2( BoidArrays const & boids, int i, Vector3f const & position, float sizeX, float sizeY )
+{
+	float	dx	= boids.m_X[ i ] - position.m_X;
+	float	dy	= boids.m_Y[ i ] - position.m_Y;
+
+	float const	dxLow	= boids.m_X[ i ] - ( position.m_X + sizeX );
+	float const	dxHigh	= boids.m_X[ i ] - ( position.m_X - sizeX );
+	float const	dyLow	= boids.m_Y[ i ] - ( position.m_Y + sizeY );
+	float const	dyHigh	= boids.m_Y[ i ] - ( position.m_Y - sizeY );
+
+	if ( fabs( dxLow ) < fabs( dx ) )	dx = dxLow;
+	if ( fabs( dxHigh ) < fabs( dx ) )	dx = dxHigh;
+	if ( fabs( dyLow ) < fabs( dy ) )	dy = dyLow;
+	if ( fabs( dyHigh ) < fabs( dy ) )	dy = dyHigh;
+
+	float const	dz	= boids.m_Z[ i ] - position.m_Z;
+
+	return ( dx * dx + dy * dy ) + dz * dz;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Find the boids within the radius of a position by searching the whole flock, sorted by distance and then by index
+
+void FindWithinEach( BoidArrays const & boids, Vector3f const & position, float radius, float sizeX, float sizeY,
+					 std::vector< Neighbor > & neighbors )
+{
+	neighbors.clear();
+
+	for ( int i = 0; i < boids.Size(); i++ )
+	{
+		float const	d2	= Distance2( boids, i, position, sizeX, sizeY );
+
+		if ( d2 < radius * radius )
+		{
+			Neighbor const	neighbor	= { d2, i };
+
+			neighbors.push_back( neighbor );
+		}
+	}
+
+	std::sort( neighbors.begin(), neighbors.end() );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Compare BoidGrid::FindNearest and BoidGrid::FindWithin with the brute-force search at random points, and return the
+// number of mismatches. The radius of each query is random, up to twice the perception distance.
+
+int CompareNeighbors( BoidArrays const & boids, BoidGrid const & grid, float sizeX, float sizeY,
+					  Vector3f const & center, float spread, RandomFloat & random )
+{
+	NeighborList			found( MAX_NEIGHBORS );
+	std::vector< Neighbor >	expected;
+	std::vector< int >		foundIndexes;
+	std::vector< int >		expectedIndexes;
+	int						mismatches	= 0;
+
+	for ( int q = 0; q < 1000; q++ )
+	{
+		// Boid::Wrap keeps the boids on the terrain, so that is where the queries are made
+
+		float const		half	= WORLD_SIZE * .5f;
+		Vector3f const	position( std::min( std::max( center.m_X + random.Next( -spread, spread ), -half ), half ),
+								  std::min( std::max( center.m_Y + random.Next( -spread, spread ), -half ), half ),
+								  random.Next( 0.f, 1.f ) );
+		float const		radius	= random.Next( 1.f, 2.f * Boid::MAX_PERCEPTION_DISTANCE );
+		int const		k		= 1 + q % 16;
+
+		FindWithinEach( boids, position, radius, sizeX, sizeY, expected );
+
+		// The k closest, in order
+
+		int const	nNearest	= grid.FindNearest( position, radius, k, found );
+		bool		same		= ( nNearest == std::min( k, int( expected.size() ) ) );
+
+		for ( int i = 0; same && i < nNearest; i++ )
+		{
+			same = ( found[ i ].m_Index == expected[ i ].m_Index &&
+					 found[ i ].m_Distance2 == expected[ i ].m_Distance2 );
+		}
+
+		// All of them, in any order
+
+		int const	nWithin		= grid.FindWithin( position, radius, found );
+
+		foundIndexes.clear();
+		for ( int i = 0; i < found.Size(); i++ )
+		{
+			foundIndexes.push_back( found[ i ].m_Index );
+		}
+		std::sort( foundIndexes.begin(), foundIndexes.end() );
+
+		expectedIndexes.clear();
+		for ( size_t i = 0; i < expected.size(); i++ )
+		{
+			expectedIndexes.push_back( expected[ i ].m_Index );
+		}
+		std::sort( expectedIndexes.begin(), expectedIndexes.end() );
+
+		same = same && ( nWithin == int( expected.size() ) ) && ( foundIndexes == expectedIndexes );
+
+		if ( !same )
+		{
+			if ( mismatches == 0 )
+			{
+				printf( "    neighbors of (%g, %g, %g) within %g: grid %d nearest and %d within, brute force %d\n",
+						position.m_X, position.m_Y, position.m_Z, radius, nNearest, nWithin, int( expected.size() ) );
+			}
+			++mismatches;
+		}
+	}
+
+	return mismatches;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Compare BoidGrid::FindClosest with the brute-force search at every boid and at random points, and return the number
+// of mismatches
+
+int CompareClosest( BoidArrays const & boids, BoidGrid const & grid, float sizeX, float sizeY, RandomFloat & random )
+{
+	int	mismatches	= 0;
+
+	for ( int i = 0; i < boids.Size() + 1000; i++ )
+	{
+		Vector3f const	position	= ( i < boids.Size() )
+									  ? boids.GetPosition( i )
+									  : Vector3f( random.Next( -WORLD_SIZE * .5f, WORLD_SIZE * .5f ),
+												  random.Next( -WORLD_SIZE * .5f, WORLD_SIZE * .5f ),
+												  random.Next( 0.f, 1.f ) );
+		Boid const		boid( position, Vector3f::ORIGIN );
+
+		int const	expected	= FlockTest::FindClosest( boid, boids, sizeX, sizeY );
+		int const	found		= grid.FindClosest( position, Boid::MAX_PERCEPTION_DISTANCE );
+
+		if ( found != expected )
+		{
+			if ( mismatches == 0 )
+			{
+				printf( "    closest to (%g, %g, %g): grid %d, brute force %d\n",
+						position.m_X, position.m_Y, position.m_Z, found, expected );
+			}
+			++mismatches;
+		}
+	}
+
+	return mismatches;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// BoidGrid::FindClosest() without wrapping returns the same boid as searching the whole flock, including ties, after
+// a build and while the grid is kept up to date incrementally
+
+bool TestGridFindClosest( HeightField const & terrain )
+{
+	static Scenario::Distribution const	distributions[]	= { Scenario::CLUSTERED, Scenario::UNIFORM };
+	static int const					sizes[]			= { 1, 100, 2000, 5000 };
+
+	int	mismatches	= 0;
+
+	for ( size_t d = 0; d < sizeof( distributions ) / sizeof( distributions[ 0 ] ); d++ )
+	{
+		for ( size_t s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); s++ )
+		{
+			Flock	flock( Flock::STORAGE_ARRAYS );
+			Scenario::SpawnBoids( flock, sizes[ s ], distributions[ d ], terrain, XY_SCALE, unsigned( s + 1 ) );
+
+			BoidArrays	boids	= flock.GetArrays();
+
+			// Some boids share a position, so that there are ties
+
+			for ( int i = 1; i < boids.Size(); i += 10 )
+			{
+				boids.SetPosition( i, boids.GetPosition( i - 1 ) );
+			}
+
+			RandomFloat	random( unsigned( s + 1 ) );
+			BoidGrid	grid;
+
+			grid.Build( boids, WORLD_SIZE, WORLD_SIZE, Boid::MAX_PERCEPTION_DISTANCE );
+			mismatches += CompareClosest( boids, grid, NO_WRAP, NO_WRAP, random );
+
+			MoveSome( boids, grid, random );
+			mismatches += CompareClosest( boids, grid, NO_WRAP, NO_WRAP, random );
+		}
+	}
+
+	printf( "    %d mismatches\n", mismatches );
+
+	return mismatches == 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Every NeighborKernel level supported by the CPU finds the same closest candidate as a simple search, including the
+// lowest id among candidates at the same distance, for every count up to several times the widest vector, and when a
+// search is split across two calls. Half of the sets are on a coarse lattice, so that there are many ties, and the ids
+// are shuffled, so that the lowest id is not always the first one found.
+
+bool TestNeighborKernel( HeightField const & /* terrain */ )
+{
+	static NeighborKernel::Level const	levels[]	=
+	{
+		NeighborKernel::LEVEL_SCALAR,
+		NeighborKernel::LEVEL_SSE2,
+		NeighborKernel::LEVEL_AVX2
+	};
+
+	NeighborKernel::Level const	original	= NeighborKernel::GetLevel();
+	int							mismatches	= 0;
+	int							ties		= 0;	// Number of searches with more than one closest candidate
+	int							tested		= 0;	// Number of levels supported
+
+	std::vector< float >	x;
+	std::vector< float >	y;
+	std::vector< float >	z;
+	std::vector< int >		id;
+
+	for ( size_t l = 0; l < sizeof( levels ) / sizeof( levels[ 0 ] ); l++ )
+	{
+		if ( NeighborKernel::SetLevel( levels[ l ] ) != levels[ l ] )
+		{
+			printf( "    level %d is not supported\n", int( levels[ l ] ) );
+			continue;
+		}
+
+		++tested;
+
+		RandomFloat	random( 1 );
+
+		for ( int set = 0; set < 2000; set++ )
+		{
+			int const	count		= set % 41;
+			bool const	lattice		= ( set & 1 ) != 0;
+
+			// The candidates start at an offset, so that they are not aligned. There is always room for one more, so
+			// that the address of the first is valid when there are none.
+
+			int const	offset		= set % 3;
+
+			x.resize( offset + count + 1 );
+			y.resize( offset + count + 1 );
+			z.resize( offset + count + 1 );
+			id.resize( offset + count + 1 );
+
+			for ( int i = offset; i < offset + count; i++ )
+			{
+				x[ i ]	= lattice ? floorf( random.Next( -3.f, 3.f ) ) : random.Next( -10.f, 10.f );
+				y[ i ]	= lattice ? floorf( random.Next( -3.f, 3.f ) ) : random.Next( -10.f, 10.f );
+				z[ i ]	= lattice ? floorf( random.Next( 0.f, 2.f ) ) : random.Next( 0.f, 2.f );
+				id[ i ]	= i - offset;
+			}
+
+			for ( int i = count - 1; i > 0; i-- )
+			{
+				int const	j	= int( random.Next( 0.f, float( i + 1 ) ) ) % ( i + 1 );
+
+				std::swap( id[ offset + i ], id[ offset + j ] );
+			}
+
+			float const	px			= lattice ? 0.f : random.Next( -10.f, 10.f );
+			float const	py			= lattice ? 0.f : random.Next( -10.f, 10.f );
+			float const	pz			= lattice ? 1.f : random.Next( 0.f, 2.f );
+			float const	maxDistance	= random.Next( 1.f, 12.f );
+
+			// The simple search
+
+			float	expectedDistance2	= maxDistance * maxDistance;
+			int		expectedId			= -1;
+			int		closest				= 0;
+
+			for ( int i = offset; i < offset + count; i++ )
+			{
+				float const	dx	= x[ i ] - px;
+				float const	dy	= y[ i ] - py;
+				float const	dz	= z[ i ] - pz;
+				float const	d2	= ( dx * dx + dy * dy ) + dz * dz;
+
+				if ( d2 < expectedDistance2 )
+				{
+					expectedDistance2 = d2;
+					expectedId = id[ i ];
+					closest = 1;
+				}
+				else if ( d2 == expectedDistance2 && expectedId >= 0 )
+				{
+					expectedId = std::min( expectedId, id[ i ] );
+					++closest;
+				}
+			}
+
+			if ( closest > 1 )
+			{
+				++ties;
+			}
+
+			// In one call, and in two calls split at a point that is not a multiple of the vector width
+
+			for ( int calls = 1; calls <= 2; calls++ )
+			{
+				int const	split			= ( calls == 1 ) ? count : count / 2 + ( count & 1 );
+				float		bestDistance2	= maxDistance * maxDistance;
+				int			bestId			= -1;
+
+				NeighborKernel::FindClosest( &x[ offset ], &y[ offset ], &z[ offset ], &id[ offset ], split,
+											 px, py, pz, bestDistance2, bestId );
+				NeighborKernel::FindClosest( &x[ offset ] + split, &y[ offset ] + split, &z[ offset ] + split,
+											 &id[ offset ] + split, count - split, px, py, pz, bestDistance2, bestId );
+
+				if ( bestId != expectedId || bestDistance2 != expectedDistance2 )
+				{
+					if ( mismatches == 0 )
+					{
+						printf( "    level %d, %d candidates: found %d at %g, expected %d at %g\n", int( levels[ l ] ),
+								count, bestId, bestDistance2, expectedId, expectedDistance2 );
+					}
+					++mismatches;
+				}
+			}
+		}
+	}
+
+	NeighborKernel::SetLevel( original );
+
+	printf( "    %d mismatches, %d levels, %d ties\n", mismatches, tested, ties );
+
+	return mismatches == 0 && ties > 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// TerrainCache::SampleHeights() gives exactly the same heights with the AVX2 gathers as one at a time, in both
+// sampling modes. SAMPLE_NEAREST gives the height at GetIndex(), which on the terrain is the height of the point that
+// Boid::AvoidTerrain uses, even at scales that are not powers of 2. The positions include every point on the edges of
+// the terrain, the points halfway between them, positions a few steps of a float away from halfway, where rounding
+// decides the nearest point, and positions off of the terrain. The counts leave every number of positions for the
+// scalar loop to finish.
+
+bool TestTerrainSampling( HeightField const & /* terrain */ )
+{
+	struct Config
+	{
+		int		m_SizeX;
+		int		m_SizeY;
+		float	m_XYScale;
+	};
+
+	static Config const					configs[]	= { { 257, 257, 1.f }, { 65, 33, .75f }, { 33, 65, 3.f } };
+	static TerrainCache::Sampling const	samplings[]	= { TerrainCache::SAMPLE_NEAREST, TerrainCache::SAMPLE_BILINEAR };
+
+	bool const	avx2		= ( NeighborKernel::GetSupportedLevel() == NeighborKernel::LEVEL_AVX2 );
+	int			mismatches	= 0;
+
+	if ( !avx2 )
+	{
+		printf( "    AVX2 is not supported, so only the scalar sampling is checked\n" );
+	}
+
+	NeighborKernel::Level const	original	= NeighborKernel::GetLevel();
+
+	for ( size_t c = 0; c < sizeof( configs ) / sizeof( configs[ 0 ] ); c++ )
+	{
+		Config const &	config	= configs[ c ];
+		HeightField		heightField( config.m_SizeX, config.m_SizeY, config.m_XYScale );
+		TerrainCache	cache;
+
+		Scenario::GenerateTerrain( heightField, Z_SCALE );
+		cache.Refresh( heightField, config.m_XYScale, Z_SCALE * .25f );
+
+		float const	halfX	= ( config.m_SizeX - 1 ) * .5f * config.m_XYScale;
+		float const	halfY	= ( config.m_SizeY - 1 ) * .5f * config.m_XYScale;
+
+		// The points on the edges and halfway between them, then positions close to halfway in each column, then
+		// positions just off of the terrain, then random positions on and around it
+
+		std::vector< float >	x;
+		std::vector< float >	y;
+		RandomFloat				random( unsigned( c + 1 ) );
+
+		for ( int i = 0; i <= 2 * ( config.m_SizeX - 1 ); i++ )
+		{
+			float const	along	= -halfX + i * .5f * config.m_XYScale;
+
+			x.push_back( along );	y.push_back( -halfY );
+			x.push_back( along );	y.push_back( halfY );
+		}
+
+		for ( int i = 0; i <= 2 * ( config.m_SizeY - 1 ); i++ )
+		{
+			float const	along	= -halfY + i * .5f * config.m_XYScale;
+
+			x.push_back( -halfX );	y.push_back( along );
+			x.push_back( halfX );	y.push_back( along );
+		}
+
+		for ( int i = 0; i < config.m_SizeX - 1; i++ )
+		{
+			float	across	= -halfX + ( i + .5f ) * config.m_XYScale;
+
+			for ( int step = 0; step < 4; step++ )
+			{
+				across = nextafterf( across, -halfX );
+			}
+
+			for ( int step = 0; step < 8; step++ )
+			{
+				x.push_back( across );	y.push_back( random.Next( -halfY, halfY ) );
+				across = nextafterf( across, halfX );
+			}
+		}
+
+		for ( int i = 0; i < 200; i++ )
+		{
+			float const	off	= random.Next( 0.f, 2.f * config.m_XYScale );
+
+			x.push_back( -halfX - off );	y.push_back( random.Next( -halfY, halfY ) );
+			x.push_back( halfX + off );		y.push_back( random.Next( -halfY, halfY ) );
+			x.push_back( random.Next( -halfX, halfX ) );	y.push_back( -halfY - off );
+			x.push_back( random.Next( -halfX, halfX ) );	y.push_back( halfY + off );
+		}
+
+		for ( int i = 0; i < 2000; i++ )
+		{
+			x.push_back( random.Next( -halfX * 1.1f, halfX * 1.1f ) );
+			y.push_back( random.Next( -halfY * 1.1f, halfY * 1.1f ) );
+		}
+
+		int const	n	= int( x.size() );
+
+		std::vector< float >	scalar( n );
+		std::vector< float >	gathered( n );
+
+		for ( size_t s = 0; s < sizeof( samplings ) / sizeof( samplings[ 0 ] ); s++ )
+		{
+			// In runs of 1 to 17, so that every count of leftovers is covered, and then all of them at once
+
+			for ( int run = 1; run <= 18; run++ )
+			{
+				int const	length	= ( run == 18 ) ? n : run;
+
+				for ( int begin = 0; begin < n; begin += length )
+				{
+					int const	count	= std::min( length, n - begin );
+
+					NeighborKernel::SetLevel( NeighborKernel::LEVEL_SCALAR );
+					cache.SampleHeights( &x[ begin ], &y[ begin ], count, &scalar[ begin ], samplings[ s ] );
+
+					NeighborKernel::SetLevel( NeighborKernel::LEVEL_AVX2 );
+					cache.SampleHeights( &x[ begin ], &y[ begin ], count, &gathered[ begin ], samplings[ s ] );
+				}
+
+				for ( int i = 0; i < n; i++ )
+				{
+					bool	same	= ( scalar[ i ] == gathered[ i ] );
+
+					if ( samplings[ s ] == TerrainCache::SAMPLE_NEAREST )
+					{
+						int const	index	= cache.GetIndex( Vector3f( x[ i ], y[ i ], 0.f ) );
+
+						same = same && ( scalar[ i ] == cache.GetHeight( index ) );
+
+						// On the terrain, the point is the one that Boid::AvoidTerrain uses, for any scale
+
+						if ( fabs( x[ i ] ) <= halfX && fabs( y[ i ] ) <= halfY )
+						{
+							int const	tx	= int( x[ i ] / config.m_XYScale + ( config.m_SizeX - 1.f ) * .5f + .5f );
+							int const	ty	= int( y[ i ] / config.m_XYScale + ( config.m_SizeY - 1.f ) * .5f + .5f );
+
+							same = same && ( scalar[ i ] == heightField.GetZ( tx, ty ) );
+						}
+					}
+
+					if ( !same )
+					{
+						if ( mismatches == 0 )
+						{
+							printf( "    sampling %d at (%g, %g) on %d x %d at %g: %g one at a time, %g gathered\n",
+									int( samplings[ s ] ), x[ i ], y[ i ], config.m_SizeX, config.m_SizeY,
+									config.m_XYScale, scalar[ i ], gathered[ i ] );
+						}
+						++mismatches;
+					}
+				}
+			}
+		}
+	}
+
+	NeighborKernel::SetLevel( original );
+
+	printf( "    %d mismatches\n", mismatches );
+
+	return mismatches == 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// With wrapping, BoidGrid::FindClosest(), FindNearest(), and FindWithin() return the same boids as searching the whole
+// flock with the distance to the nearest image of each boid. Most of the boids and queries are near the edges and the
+// corners of the terrain, where the nearest image is on the other side.
+
+bool TestGridWrap( HeightField const & terrain )
+{
+	float const	half		= WORLD_SIZE * .5f;
+	float const	band		= Boid::MAX_PERCEPTION_DISTANCE * 1.5f;
+
+	// Queries are centered on the seams at the edges and at a corner
+
+	Vector3f const	seams[]	=
+	{
+		Vector3f( -half, 0.f, 0.f ),
+		Vector3f( half, 0.f, 0.f ),
+		Vector3f( 0.f, -half, 0.f ),
+		Vector3f( 0.f, half, 0.f ),
+		Vector3f( half, half, 0.f )
+	};
+
+	int	mismatches	= 0;
+
+	for ( unsigned int seed = 1; seed <= 4; seed++ )
+	{
+		Flock	flock( Flock::STORAGE_ARRAYS );
+		Scenario::SpawnBoids( flock, 500, Scenario::UNIFORM, terrain, XY_SCALE, seed );
+
+		BoidArrays	boids	= flock.GetArrays();
+		RandomFloat	random( seed );
+
+		// Add boids in a band along each edge, on both sides of the seam, including some exactly on an edge
+
+		for ( int i = 0; i < 2000; i++ )
+		{
+			float const	across	= ( i % 50 == 0 ) ? half : half - random.Next( 0.f, band );
+			float const	along	= random.Next( -half, half );
+			float const	side	= ( i & 1 ) ? 1.f : -1.f;
+			float const	x		= ( i & 2 ) ? side * across : along;
+			float const	y		= ( i & 2 ) ? along : side * across;
+
+			boids.Add( Vector3f( x, y, random.Next( 0.f, 1.f ) ), Vector3f::ORIGIN );
+		}
+
+		BoidGrid	grid;
+
+		grid.Build( boids, WORLD_SIZE, WORLD_SIZE, Boid::MAX_PERCEPTION_DISTANCE, true );
+		mismatches += CompareClosest( boids, grid, WORLD_SIZE, WORLD_SIZE, random );
+
+		for ( size_t s = 0; s < sizeof( seams ) / sizeof( seams[ 0 ] ); s++ )
+		{
+			mismatches += CompareNeighbors( boids, grid, WORLD_SIZE, WORLD_SIZE, seams[ s ], band, random );
+		}
+
+		MoveSome( boids, grid, random );
+		mismatches += CompareClosest( boids, grid, WORLD_SIZE, WORLD_SIZE, random );
+
+		for ( size_t s = 0; s < sizeof( seams ) / sizeof( seams[ 0 ] ); s++ )
+		{
+			mismatches += CompareNeighbors( boids, grid, WORLD_SIZE, WORLD_SIZE, seams[ s ], band, random );
+		}
+	}
+
+	printf( "    %d mismatches\n", mismatches );
+
+	return mismatches == 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Return the number of boids whose positions or velocities are not exactly the same in the two flocks, matching the
+// boids by ID
+
+int CompareFlocks( Flock const & a, Flock const & b )
+{
+	if ( a.GetCount() != b.GetCount() )
+	{
+		return std::max( a.GetCount(), b.GetCount() );
+	}
+
+	int	mismatches	= 0;
+
+	for ( int id = 0; id < a.GetCount(); id++ )
+	{
+		Vector3f const	pa	= a.GetPosition( id );
+		Vector3f const	pb	= b.GetPosition( id );
+		Vector3f const	va	= a.GetVelocity( id );
+		Vector3f const	vb	= b.GetVelocity( id );
+
+		if ( pa.m_X != pb.m_X || pa.m_Y != pb.m_Y || pa.m_Z != pb.m_Z ||
+			 va.m_X != vb.m_X || va.m_Y != vb.m_Y || va.m_Z != vb.m_Z )
+		{
+			if ( mismatches == 0 )
+			{
+				printf( "    boid %d: (%g, %g, %g) moving (%g, %g, %g), and (%g, %g, %g) moving (%g, %g, %g)\n",
+						id, pa.m_X, pa.m_Y, pa.m_Z, va.m_X, va.m_Y, va.m_Z,
+						pb.m_X, pb.m_Y, pb.m_Z, vb.m_X, vb.m_Y, vb.m_Z );
+			}
+			++mismatches;
+		}
+	}
+
+	return mismatches;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// UPDATE_DOUBLE_BUFFERED updates on several threads give exactly the same boids as on one thread, in both storage
+// modes, over many updates
+
+bool TestThreadedUpdate( HeightField const & terrain )
+{
+	static Flock::StorageMode const	storageModes[]	= { Flock::STORAGE_ARRAYS, Flock::STORAGE_OBJECTS };
+	static int const				threadCounts[]	= { 2, 3, 8 };
+
+	float const	seaLevel	= Z_SCALE * .25f;
+	int			mismatches	= 0;
+
+	for ( size_t m = 0; m < sizeof( storageModes ) / sizeof( storageModes[ 0 ] ); m++ )
+	{
+		for ( size_t t = 0; t < sizeof( threadCounts ) / sizeof( threadCounts[ 0 ] ); t++ )
+		{
+			unsigned int const	seed	= unsigned( t + 1 );
+
+			Flock	serial( storageModes[ m ] );
+			Flock	threaded( storageModes[ m ] );
+
+			serial.SetUpdateMode( Flock::UPDATE_DOUBLE_BUFFERED );
+			threaded.SetUpdateMode( Flock::UPDATE_DOUBLE_BUFFERED );
+			serial.SetThreadCount( 1 );
+			threaded.SetThreadCount( threadCounts[ t ] );
+
+			Scenario::SpawnBoids( serial, 1500, Scenario::UNIFORM, terrain, XY_SCALE, seed );
+			Scenario::SpawnBoids( serial, 500, Scenario::CLUSTERED, terrain, XY_SCALE, seed );
+			Scenario::SpawnBoids( threaded, 1500, Scenario::UNIFORM, terrain, XY_SCALE, seed );
+			Scenario::SpawnBoids( threaded, 500, Scenario::CLUSTERED, terrain, XY_SCALE, seed );
+
+			for ( int step = 0; step < 60; step++ )
+			{
+				serial.Update( 1.f / 60.f, terrain, XY_SCALE, seaLevel );
+				threaded.Update( 1.f / 60.f, terrain, XY_SCALE, seaLevel );
+
+				mismatches += CompareFlocks( serial, threaded );
+			}
+		}
+	}
+
+	printf( "    %d mismatches\n", mismatches );
+
+	return mismatches == 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Add boids in a band along each edge of the terrain, flying across the seam, so that they wrap to the other side
+
+void AddSeamBoids( Flock & flock, int n, RandomFloat & random )
+{
+	float const	half	= WORLD_SIZE * .5f;
+	float const	speed	= Boid::DESIRED_SPEED;
+
+	for ( int i = 0; i < n; i++ )
+	{
+		float const	across	= half - random.Next( 0.f, 2.f );
+		float const	along	= random.Next( -half, half );
+		float const	side	= ( i & 1 ) ? 1.f : -1.f;
+		bool const	onX		= ( i & 2 ) != 0;
+
+		Vector3f const	position( onX ? side * across : along, onX ? along : side * across, random.Next( 0.f, 1.f ) );
+		Vector3f const	velocity( onX ? side * speed : random.Next( -speed, speed ),
+								  onX ? random.Next( -speed, speed ) : side * speed,
+								  0.f );
+
+		flock.Add( position, velocity );
+	}
+}
+
+
+// Return the number of random queries for which Flock::FindNearest() and FindWithin() do not find the same boids in
+// the two flocks. Half of the queries are on the seams at the edges of the terrain.
+
+int CompareQueries( Flock & a, Flock & b, RandomFloat & random )
+{
+	float const	half		= WORLD_SIZE * .5f;
+	int			mismatches	= 0;
+
+	NeighborList		foundA( MAX_NEIGHBORS );
+	NeighborList		foundB( MAX_NEIGHBORS );
+	std::vector< int >	idsA;
+	std::vector< int >	idsB;
+
+	for ( int q = 0; q < 100; q++ )
+	{
+		float const		along	= random.Next( -half, half );
+		float const		across	= ( q & 2 ) ? half : -half;
+		Vector3f const	position	= ( q & 1 )
+									  ? Vector3f( random.Next( -half, half ), random.Next( -half, half ), 0.f )
+									  : ( ( q & 4 ) ? Vector3f( across, along, 0.f ) : Vector3f( along, across, 0.f ) );
+		float const		radius	= random.Next( 1.f, 2.f * Boid::MAX_PERCEPTION_DISTANCE );
+		int const		k		= 1 + q % 16;
+
+		// The k closest, in order
+
+		int const	nNearest	= a.FindNearest( position, radius, k, foundA );
+		bool		same		= ( nNearest == b.FindNearest( position, radius, k, foundB ) );
+
+		for ( int i = 0; same && i < nNearest; i++ )
+		{
+			same = ( foundA[ i ].m_Index == foundB[ i ].m_Index && foundA[ i ].m_Distance2 == foundB[ i ].m_Distance2 );
+		}
+
+		// All of them, in any order
+
+		a.FindWithin( position, radius, foundA );
+		b.FindWithin( position, radius, foundB );
+
+		idsA.clear();
+		for ( int i = 0; i < foundA.Size(); i++ )
+		{
+			idsA.push_back( foundA[ i ].m_Index );
+		}
+		std::sort( idsA.begin(), idsA.end() );
+
+		idsB.clear();
+		for ( int i = 0; i < foundB.Size(); i++ )
+		{
+			idsB.push_back( foundB[ i ].m_Index );
+		}
+		std::sort( idsB.begin(), idsB.end() );
+
+		if ( !same || idsA != idsB )
+		{
+			++mismatches;
+		}
+	}
+
+	return mismatches;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// INDEX_INCREMENTAL gives exactly the same boids and neighbors as INDEX_REBUILD over many updates in both update
+// modes, with boids crossing the seams at the edges, and with rebuild thresholds that rebuild the grid often and
+// almost never
+
+bool TestIndexModes( HeightField const & terrain )
+{
+	static Flock::UpdateMode const	updateModes[]	= { Flock::UPDATE_IN_PLACE, Flock::UPDATE_DOUBLE_BUFFERED };
+	static float const				thresholds[]	= { .01f, 1.f };
+
+	float const	half		= WORLD_SIZE * .5f;
+	float const	seaLevel	= Z_SCALE * .25f;
+	int			mismatches	= 0;
+	int			moved		= 0;	// Number of updates after which the grid was not rebuilt
+	int			crossings	= 0;	// Number of times a boid wrapped to the other side
+
+	for ( size_t m = 0; m < sizeof( updateModes ) / sizeof( updateModes[ 0 ] ); m++ )
+	{
+		for ( size_t t = 0; t < sizeof( thresholds ) / sizeof( thresholds[ 0 ] ); t++ )
+		{
+			unsigned int const	seed	= unsigned( m * 2 + t + 1 );
+
+			Flock		rebuilt( Flock::STORAGE_ARRAYS );
+			Flock		incremental( Flock::STORAGE_ARRAYS );
+			RandomFloat	random( seed );
+
+			rebuilt.SetIndexMode( Flock::INDEX_REBUILD );
+			incremental.SetIndexMode( Flock::INDEX_INCREMENTAL );
+			incremental.SetRebuildThreshold( thresholds[ t ] );
+
+			for ( int f = 0; f < 2; f++ )
+			{
+				Flock &		flock	= f ? incremental : rebuilt;
+				RandomFloat	seam( seed );
+
+				flock.SetUpdateMode( updateModes[ m ] );
+				Scenario::SpawnBoids( flock, 1500, Scenario::UNIFORM, terrain, XY_SCALE, seed );
+				Scenario::SpawnBoids( flock, 500, Scenario::CLUSTERED, terrain, XY_SCALE, seed );
+				AddSeamBoids( flock, 500, seam );
+			}
+
+			for ( int step = 0; step < 300; step++ )
+			{
+				std::vector< Vector3f >	before;
+
+				for ( int id = 0; id < incremental.GetCount(); id++ )
+				{
+					before.push_back( incremental.GetPosition( id ) );
+				}
+
+				rebuilt.Update( 1.f / 60.f, terrain, XY_SCALE, seaLevel );
+				incremental.Update( 1.f / 60.f, terrain, XY_SCALE, seaLevel );
+
+				if ( !incremental.GetIndexStats().m_Rebuilt )
+				{
+					++moved;
+				}
+
+				for ( int id = 0; id < incremental.GetCount(); id++ )
+				{
+					Vector3f const	to	= incremental.GetPosition( id );
+
+					if ( fabs( to.m_X - before[ id ].m_X ) > half || fabs( to.m_Y - before[ id ].m_Y ) > half )
+					{
+						++crossings;
+					}
+				}
+
+				mismatches += CompareFlocks( rebuilt, incremental );
+				mismatches += CompareQueries( rebuilt, incremental, random );
+			}
+		}
+	}
+
+	printf( "    %d mismatches, %d updates without a rebuild, %d crossings\n", mismatches, moved, crossings );
+
+	return mismatches == 0 && moved > 0 && crossings > 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Sorting the arrays along the Z-curve by every update keeps the IDs, the handles, and the level of detail of every
+// boid. The sorted flock is compared by ID with a flock that is never sorted. Both are updated with
+// UPDATE_DOUBLE_BUFFERED, which does not depend on the order of the boids, and some boids are despawned along the way
+// so that the IDs are not in the order the boids were spawned.
+
+bool TestSortKeepsIds( HeightField const & terrain )
+{
+	float const			seaLevel	= Z_SCALE * .25f;
+	int const			n			= 3000;
+	DistanceImportance	importance( Vector3f::ORIGIN, 30.f );
+	int					mismatches	= 0;
+	int					reordered	= 0;	// Number of times a boid was not at the index of its ID
+
+	for ( int lod = 0; lod < 2; lod++ )
+	{
+		Flock	unsorted( Flock::STORAGE_ARRAYS );
+		Flock	sorted( Flock::STORAGE_ARRAYS );
+
+		std::vector< Vector3f >			positions;
+		std::vector< Vector3f >			velocities;
+		std::vector< Flock::Handle >	handles( n );
+		RandomFloat						random( unsigned( lod + 1 ) );
+
+		for ( int i = 0; i < n; i++ )
+		{
+			float const	half	= WORLD_SIZE * .5f;
+			float const	speed	= Boid::DESIRED_SPEED;
+
+			positions.push_back( Vector3f( random.Next( -half, half ), random.Next( -half, half ),
+										   random.Next( 0.f, 1.f ) ) );
+			velocities.push_back( Vector3f( random.Next( -speed, speed ), random.Next( -speed, speed ), 0.f ) );
+		}
+
+		for ( int f = 0; f < 2; f++ )
+		{
+			Flock &	flock	= f ? sorted : unsorted;
+
+			flock.SetUpdateMode( Flock::UPDATE_DOUBLE_BUFFERED );
+			flock.SetSortInterval( f ? 1 : 0 );
+			flock.SetImportance( lod ? &importance : 0 );
+			flock.Spawn( n, &positions[ 0 ], &velocities[ 0 ], &handles[ 0 ] );
+		}
+
+		for ( int step = 0; step < 40; step++ )
+		{
+			if ( step == 10 )
+			{
+				std::vector< Flock::Handle >	removed;
+
+				for ( int i = 0; i < n; i += 5 )
+				{
+					removed.push_back( handles[ i ] );
+				}
+
+				unsorted.Despawn( int( removed.size() ), &removed[ 0 ] );
+				sorted.Despawn( int( removed.size() ), &removed[ 0 ] );
+			}
+
+			unsorted.Update( 1.f / 60.f, terrain, XY_SCALE, seaLevel );
+			sorted.Update( 1.f / 60.f, terrain, XY_SCALE, seaLevel );
+
+			mismatches += CompareFlocks( unsorted, sorted );
+
+			// Every handle finds the same ID, and every ID has the same handle
+
+			for ( int i = 0; i < n; i++ )
+			{
+				if ( sorted.GetId( handles[ i ] ) != unsorted.GetId( handles[ i ] ) )
+				{
+					++mismatches;
+				}
+			}
+
+			for ( int id = 0; id < sorted.GetCount(); id++ )
+			{
+				Flock::Handle const	a	= unsorted.GetHandle( id );
+				Flock::Handle const	b	= sorted.GetHandle( id );
+
+				if ( a.m_Index != b.m_Index || a.m_Generation != b.m_Generation )
+				{
+					++mismatches;
+				}
+
+				// The ID and the index lead to each other and to the same boid
+
+				int const	slot	= sorted.GetSlot( id );
+
+				if ( sorted.GetId( slot ) != id )
+				{
+					++mismatches;
+				}
+
+				Vector3f const	inArrays	= sorted.GetArrays().GetPosition( slot );
+				Vector3f const	byId		= sorted.GetPosition( id );
+
+				if ( inArrays.m_X != byId.m_X || inArrays.m_Y != byId.m_Y || inArrays.m_Z != byId.m_Z )
+				{
+					++mismatches;
+				}
+
+				if ( slot != id )
+				{
+					++reordered;
+				}
+			}
+		}
+	}
+
+	printf( "    %d mismatches, %d boids reordered\n", mismatches, reordered );
+
+	return mismatches == 0 && reordered > 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// BoidPool keeps every boid it allocates intact until it is freed, reuses freed slots before adding pages, and after
+// Clear() reuses the pages that it has. Run under a memory checker, this also shows that no boid is destroyed twice or
+// leaked, and that no freed slot is used.
+
+bool TestBoidPool( HeightField const & /* terrain */ )
+{
+	int	mismatches	= 0;
+
+	for ( unsigned int seed = 1; seed <= 4; seed++ )
+	{
+		BoidPool				pool;
+		RandomFloat				random( seed );
+		std::vector< Boid * >	live;
+		int						peak	= 0;
+
+		// Allocate and free boids in a random order. Each boid is given a position that identifies it.
+
+		for ( int step = 0; step < 20000; step++ )
+		{
+			if ( live.empty() || random.Next( 0.f, 1.f ) < .55f )
+			{
+				float const	id	= float( step );
+
+				live.push_back( pool.Allocate( Vector3f( id, -id, 0.f ), Vector3f::ORIGIN ) );
+			}
+			else
+			{
+				size_t const	i	= size_t( random.Next( 0.f, float( live.size() ) ) ) % live.size();
+
+				pool.Free( live[ i ] );
+				live[ i ] = live.back();
+				live.pop_back();
+			}
+
+			peak = std::max( peak, int( live.size() ) );
+
+			if ( pool.GetCount() != int( live.size() ) )
+			{
+				++mismatches;
+			}
+		}
+
+		// The live boids are intact and distinct, and no more pages were added than the peak needs
+
+		std::vector< Boid * >	sorted( live );
+
+		std::sort( sorted.begin(), sorted.end() );
+		if ( std::adjacent_find( sorted.begin(), sorted.end() ) != sorted.end() )
+		{
+			++mismatches;
+		}
+
+		for ( size_t i = 0; i < live.size(); i++ )
+		{
+			if ( live[ i ]->m_Position.m_X != -live[ i ]->m_Position.m_Y )
+			{
+				++mismatches;
+			}
+		}
+
+		int const	pages	= ( peak + BoidPool::PAGE_SIZE - 1 ) / BoidPool::PAGE_SIZE;
+
+		if ( pool.GetCapacity() != pages * BoidPool::PAGE_SIZE )
+		{
+			++mismatches;
+		}
+
+		// Clear() destroys the rest, and then the pool fills its pages again before adding one
+
+		int const	capacity	= pool.GetCapacity();
+
+		pool.Clear();
+		live.clear();
+
+		if ( pool.GetCount() != 0 || pool.GetCapacity() != capacity )
+		{
+			++mismatches;
+		}
+
+		for ( int i = 0; i < capacity; i++ )
+		{
+			live.push_back( pool.Allocate( Vector3f::ORIGIN, Vector3f::ORIGIN ) );
+		}
+
+		if ( pool.GetCapacity() != capacity )
+		{
+			++mismatches;
+		}
+
+		pool.Allocate( Vector3f::ORIGIN, Vector3f::ORIGIN );
+
+		if ( pool.GetCapacity() != capacity + BoidPool::PAGE_SIZE || pool.GetCount() != capacity + 1 )
+		{
+			++mismatches;
+		}
+	}
+
+	printf( "    %d mismatches\n", mismatches );
+
+	return mismatches == 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Despawning and spawning boids at random keeps every live handle pointing at its own boid and rejects every handle to
+// a despawned boid, even after its entry has been reused by a new boid. The boid that fills the hole left by a
+// despawned boid keeps its handle, and the boids stay densely packed. Each boid is given a position that identifies
+// it, and the flock is not updated, so the positions do not change.
+
+bool TestHandles( HeightField const & /* terrain */ )
+{
+	static Flock::StorageMode const	storageModes[]	= { Flock::STORAGE_ARRAYS, Flock::STORAGE_OBJECTS };
+
+	int	mismatches	= 0;
+	int	reused		= 0;	// Number of spawned boids given the entry of a despawned boid
+	int	filled		= 0;	// Number of despawned boids whose ID was taken by another boid
+
+	for ( size_t m = 0; m < sizeof( storageModes ) / sizeof( storageModes[ 0 ] ); m++ )
+	{
+		Flock							flock( storageModes[ m ] );
+		RandomFloat						random( unsigned( m + 1 ) );
+		std::vector< Flock::Handle >	live;
+		std::vector< float >			marks;		// Position of each live boid, which identifies it
+		std::vector< Flock::Handle >	dead;
+		std::vector< bool >				found;
+
+		for ( int step = 0; step < 3000; step++ )
+		{
+			if ( live.empty() || random.Next( 0.f, 1.f ) < .45f )
+			{
+				float const		mark	= float( step );
+				Vector3f const	position( mark, -mark, 0.f );
+				Flock::Handle	handle;
+
+				flock.Spawn( 1, &position, &Vector3f::ORIGIN, &handle );
+
+				// The entry of the last boid despawned is reused first, so its handle is now stale
+
+				if ( !dead.empty() && handle.m_Index == dead.back().m_Index )
+				{
+					++reused;
+					if ( handle.m_Generation == dead.back().m_Generation || flock.GetId( dead.back() ) != -1 )
+					{
+						++mismatches;
+					}
+				}
+
+				live.push_back( handle );
+				marks.push_back( mark );
+			}
+			else
+			{
+				size_t const		i		= size_t( random.Next( 0.f, float( live.size() ) ) ) % live.size();
+				Flock::Handle const	handle	= live[ i ];
+				int const			id		= flock.GetId( handle );
+				Flock::Handle const	last	= flock.GetHandle( flock.GetCount() - 1 );
+
+				// Despawning it again does nothing
+
+				if ( flock.Despawn( 1, &handle ) != 1 || flock.GetId( handle ) != -1 ||
+					 flock.Despawn( 1, &handle ) != 0 )
+				{
+					++mismatches;
+				}
+
+				// The boid with the last ID takes the despawned boid's ID
+
+				if ( id != flock.GetCount() )
+				{
+					++filled;
+					if ( flock.GetId( last ) != id )
+					{
+						++mismatches;
+					}
+				}
+
+				dead.push_back( handle );
+				live[ i ] = live.back();
+				live.pop_back();
+				marks[ i ] = marks.back();
+				marks.pop_back();
+			}
+
+			// The boids are packed without gaps
+
+			int const	n	= flock.GetCount();
+
+			if ( n != int( live.size() ) ||
+				 ( storageModes[ m ] == Flock::STORAGE_ARRAYS && flock.GetArrays().Size() != n ) ||
+				 ( storageModes[ m ] == Flock::STORAGE_OBJECTS && int( flock.size() ) != n ) )
+			{
+				++mismatches;
+			}
+
+			// Every live handle finds its own boid, and no two find the same one
+
+			found.assign( n, false );
+
+			for ( size_t i = 0; i < live.size(); i++ )
+			{
+				int const	id	= flock.GetId( live[ i ] );
+
+				if ( id < 0 || id >= n || found[ id ] )
+				{
+					++mismatches;
+					continue;
+				}
+
+				found[ id ] = true;
+
+				Flock::Handle const	handle		= flock.GetHandle( id );
+				Vector3f const		position	= flock.GetPosition( id );
+
+				if ( handle.m_Index != live[ i ].m_Index || handle.m_Generation != live[ i ].m_Generation ||
+					 position.m_X != marks[ i ] || position.m_Y != -marks[ i ] )
+				{
+					++mismatches;
+				}
+
+				if ( storageModes[ m ] == Flock::STORAGE_ARRAYS &&
+					 flock.GetArrays().GetPosition( flock.GetSlot( id ) ).m_X != marks[ i ] )
+				{
+					++mismatches;
+				}
+			}
+
+			// Every dead handle is rejected
+
+			for ( size_t i = 0; i < dead.size(); i++ )
+			{
+				if ( flock.GetId( dead[ i ] ) != -1 )
+				{
+					++mismatches;
+				}
+			}
+		}
+	}
+
+	printf( "    %d mismatches, %d entries reused, %d IDs filled\n", mismatches, reused, filled );
+
+	return mismatches == 0 && reused > 0 && filled > 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Return the number of differences between a mesh and the height field that it was built from, including the
+// triangles, which must be those of the strips of the old drawing code in the same order. Each row i of squares was a
+// strip alternating between the points of rows i + 1 and i, starting at the left, with the winding flipped on every
+// other triangle as in GL_TRIANGLE_STRIP.
+
+int CompareMesh( HeightFieldMesh const & mesh, HeightField const & heightField, float xyScale, float texCoordScale )
+{
+	int const	sx			= heightField.GetSizeX();
+	int const	sy			= heightField.GetSizeY();
+	float const	x0			= -( sx - 1 ) * .5f * xyScale;
+	float const	y0			= -( sy - 1 ) * .5f * xyScale;
+	int			mismatches	= 0;
+
+	if ( mesh.GetVertexCount() != sx * sy )
+	{
+		return 1;
+	}
+
+	for ( int i = 0; i < sy; i++ )
+	{
+		for ( int j = 0; j < sx; j++ )
+		{
+			HeightFieldMesh::Vertex const &	v	= mesh.GetVertices()[ i * sx + j ];
+			HeightField::Vertex const &		h	= *heightField.GetData( j, i );
+
+			if ( v.m_TexCoord[ 0 ] != float( j ) * texCoordScale || v.m_TexCoord[ 1 ] != float( i ) * texCoordScale ||
+				 v.m_Position[ 0 ] != x0 + j * xyScale || v.m_Position[ 1 ] != y0 + i * xyScale ||
+				 v.m_Position[ 2 ] != h.m_Z ||
+				 v.m_Normal[ 0 ] != h.m_Normal.m_X || v.m_Normal[ 1 ] != h.m_Normal.m_Y ||
+				 v.m_Normal[ 2 ] != h.m_Normal.m_Z )
+			{
+				++mismatches;
+			}
+		}
+	}
+
+	// Expand the strips into triangles
+
+	std::vector< unsigned int >	expected;
+
+	for ( int i = 0; i < sy - 1; i++ )
+	{
+		std::vector< unsigned int >	strip;
+
+		for ( int j = 0; j < sx; j++ )
+		{
+			strip.push_back( ( i + 1 ) * sx + j );
+			strip.push_back( i * sx + j );
+		}
+
+		for ( size_t k = 0; k + 2 < strip.size(); k++ )
+		{
+			bool const	flip	= ( k & 1 ) != 0;
+
+			expected.push_back( strip[ flip ? k + 1 : k ] );
+			expected.push_back( strip[ flip ? k : k + 1 ] );
+			expected.push_back( strip[ k + 2 ] );
+		}
+	}
+
+	int const	expectedCount	= ( sx > 1 && sy > 1 ) ? ( sx - 1 ) * ( sy - 1 ) * 6 : 0;
+
+	if ( mesh.GetIndexCount() != expectedCount || int( expected.size() ) != expectedCount )
+	{
+		return mismatches + 1;
+	}
+
+	for ( int k = 0; k < expectedCount; k++ )
+	{
+		if ( mesh.GetIndices()[ k ] != expected[ k ] )
+		{
+			++mismatches;
+		}
+	}
+
+	// The triangles face up, so they are counterclockwise when seen from above
+
+	for ( int k = 0; k < expectedCount; k += 3 )
+	{
+		float const * const	p0	= mesh.GetVertices()[ mesh.GetIndices()[ k ] ].m_Position;
+		float const * const	p1	= mesh.GetVertices()[ mesh.GetIndices()[ k + 1 ] ].m_Position;
+		float const * const	p2	= mesh.GetVertices()[ mesh.GetIndices()[ k + 2 ] ].m_Position;
+
+		if ( ( p1[ 0 ] - p0[ 0 ] ) * ( p2[ 1 ] - p0[ 1 ] ) - ( p1[ 1 ] - p0[ 1 ] ) * ( p2[ 0 ] - p0[ 0 ] ) <= 0.f )
+		{
+			++mismatches;
+		}
+	}
+
+	return mismatches;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// HeightFieldMesh builds the vertices and triangles that the strips of the old drawing code drew, for small height
+// fields of several shapes and for the terrain, and UpdateHeights() copies new heights and normals.
+
+bool TestHeightFieldMesh( HeightField const & terrain )
+{
+	int const	sizes[][ 2 ]	= { { 2, 2 }, { 5, 4 }, { 3, 7 }, { 1, 6 }, { 6, 1 }, { 17, 17 } };
+	int			mismatches		= 0;
+	RandomFloat	random( 1 );
+
+	for ( size_t s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); s++ )
+	{
+		HeightField	field( sizes[ s ][ 0 ], sizes[ s ][ 1 ], 2.f );
+		int const	n		= field.GetSizeX() * field.GetSizeY();
+
+		for ( int i = 0; i < n; i++ )
+		{
+			field.GetData()[ i ].m_Z = random.Next( -1.f, 1.f );
+			field.GetData()[ i ].m_Normal = Vector3f( random.Next( -1.f, 1.f ), random.Next( -1.f, 1.f ), 1.f );
+		}
+
+		HeightFieldMesh	mesh;
+
+		mesh.Build( field, 2.f, .125f );
+		mismatches += CompareMesh( mesh, field, 2.f, .125f );
+
+		for ( int i = 0; i < n; i++ )
+		{
+			field.GetData()[ i ].m_Z = random.Next( -1.f, 1.f );
+			field.GetData()[ i ].m_Normal = Vector3f( 0.f, random.Next( -1.f, 1.f ), 1.f );
+		}
+
+		mesh.UpdateHeights( field );
+		mismatches += CompareMesh( mesh, field, 2.f, .125f );
+	}
+
+	HeightFieldMesh	mesh;
+
+	mesh.Build( terrain, XY_SCALE, .125f );
+	mismatches += CompareMesh( mesh, terrain, XY_SCALE, .125f );
+
+	printf( "    %d mismatches\n", mismatches );
+
+	return mismatches == 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Set a projection matrix as gluPerspective() does, in column-major order
+
+void Perspective( float fovY, float aspect, float zNear, float zFar, float * m )
+{
+	float const	f	= 1.f / tanf( fovY * .5f * 3.14159265f / 180.f );
+
+	std::fill( m, m + 16, 0.f );
+	m[ 0 ]	= f / aspect;
+	m[ 5 ]	= f;
+	m[ 10 ]	= ( zFar + zNear ) / ( zNear - zFar );
+	m[ 11 ]	= -1.f;
+	m[ 14 ]	= 2.f * zFar * zNear / ( zNear - zFar );
+}
+
+
+// Set a view matrix as gluLookAt() does with Z up, in column-major order
+
+void LookAt( Vector3f const & eye, Vector3f const & target, float * m )
+{
+	Vector3f	f	= target - eye;
+
+	f = f * ( 1.f / f.Length() );
+
+	// s = f x up and u = s x f, with up = ( 0, 0, 1 )
+
+	Vector3f	s( f.m_Y, -f.m_X, 0.f );
+
+	s = s * ( 1.f / s.Length() );
+
+	Vector3f const	u( s.m_Y * f.m_Z - s.m_Z * f.m_Y, s.m_Z * f.m_X - s.m_X * f.m_Z, s.m_X * f.m_Y - s.m_Y * f.m_X );
+
+	float const	view[ 16 ]	=
+	{
+		s.m_X,	u.m_X,	-f.m_X,	0.f,
+		s.m_Y,	u.m_Y,	-f.m_Y,	0.f,
+		s.m_Z,	u.m_Z,	-f.m_Z,	0.f,
+		-( s.m_X * eye.m_X + s.m_Y * eye.m_Y + s.m_Z * eye.m_Z ),
+		-( u.m_X * eye.m_X + u.m_Y * eye.m_Y + u.m_Z * eye.m_Z ),
+		f.m_X * eye.m_X + f.m_Y * eye.m_Y + f.m_Z * eye.m_Z,
+		1.f
+	};
+
+	std::copy( view, view + 16, m );
+}
+
+
+// Return the number of random views in which BoidCulling::Cull() and CullEach() do not find the same boids. The boids
+// are checked at their positions in the flock, and at positions moved by up to the given distance, with a margin that
+// covers the move.
+
+int CompareCulling( Flock & flock, float jitter, RandomFloat & random )
+{
+	float const	half		= WORLD_SIZE * .5f;
+	float const	radius		= 1.1f;
+	int			mismatches	= 0;
+
+	BoidArrays	positions;
+
+	for ( int id = 0; id < flock.GetCount(); id++ )
+	{
+		Vector3f const	offset( random.Next( -jitter, jitter ), random.Next( -jitter, jitter ),
+								random.Next( -jitter, jitter ) );
+
+		positions.Add( flock.GetPosition( id ) + offset, flock.GetVelocity( id ) );
+	}
+
+	float const	margin	= jitter * 1.75f;	// More than the length of the longest offset, jitter * sqrt( 3 )
+
+	float	projection[ 16 ];
+
+	Perspective( 60.f, 4.f / 3.f, 1.f, 1000.f, projection );
+
+	std::vector< int >	grid;
+	std::vector< int >	each;
+
+	for ( int view = 0; view < 40; view++ )
+	{
+		// Every other view is looking down from above the terrain, and the rest are from low, looking across it. The
+		// first view sees everything.
+
+		Vector3f const	eye( random.Next( -half, half ), random.Next( -half, half ),
+							 ( view & 1 ) ? random.Next( 50.f, 200.f ) : random.Next( 5.f, 30.f ) );
+		Vector3f const	target( random.Next( -half, half ), random.Next( -half, half ), random.Next( 0.f, 20.f ) );
+
+		float	matrix[ 16 ];
+
+		LookAt( eye, target, matrix );
+
+		Frustum	frustum( projection, matrix );
+
+		if ( view == 0 )
+		{
+			frustum = Frustum();
+		}
+		else if ( view % 3 == 0 )
+		{
+			frustum.SetMaxDistance( random.Next( 20.f, 200.f ) );
+		}
+
+		BoidCulling::Cull( flock, positions, frustum, radius, margin, grid );
+		BoidCulling::CullEach( positions, frustum, radius, each );
+
+		std::sort( grid.begin(), grid.end() );
+
+		if ( grid != each )
+		{
+			++mismatches;
+		}
+	}
+
+	return mismatches;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// BoidCulling::Cull() finds exactly the boids that CullEach() finds, in both storage modes, while the grid is kept up
+// to date incrementally by the updates, and while the arrays are reordered along the Z-curve by every update.
+
+bool TestCulling( HeightField const & terrain )
+{
+	struct Config
+	{
+		Flock::StorageMode	m_StorageMode;
+		int					m_SortInterval;
+	};
+
+	Config const	configs[]	=
+	{
+		{ Flock::STORAGE_ARRAYS,	0 },
+		{ Flock::STORAGE_ARRAYS,	1 },
+		{ Flock::STORAGE_OBJECTS,	0 }
+	};
+
+	float const	seaLevel	= Z_SCALE * .25f;
+	int			mismatches	= 0;
+	int			moved		= 0;	// Number of updates after which the grid was not rebuilt
+
+	for ( size_t c = 0; c < sizeof( configs ) / sizeof( configs[ 0 ] ); c++ )
+	{
+		for ( unsigned int seed = 1; seed <= 2; seed++ )
+		{
+			Flock	flock( configs[ c ].m_StorageMode );
+
+			flock.SetIndexMode( Flock::INDEX_INCREMENTAL );
+			flock.SetSortInterval( configs[ c ].m_SortInterval );
+
+			Scenario::SpawnBoids( flock, 3000, Scenario::UNIFORM, terrain, XY_SCALE, seed );
+			Scenario::SpawnBoids( flock, 1000, Scenario::CLUSTERED, terrain, XY_SCALE, seed );
+
+			RandomFloat	random( seed );
+
+			for ( int step = 0; step < 8; step++ )
+			{
+				flock.Update( 1.f / 60.f, terrain, XY_SCALE, seaLevel );
+
+				if ( !flock.GetIndexStats().m_Rebuilt )
+				{
+					++moved;
+				}
+
+				mismatches += CompareCulling( flock, 0.f, random );
+				mismatches += CompareCulling( flock, .5f, random );
+			}
+		}
+	}
+
+	printf( "    %d mismatches, %d updates without a rebuild\n", mismatches, moved );
+
+	return mismatches == 0 && moved > 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Usage()
+{
+	fprintf( stderr, "usage: FlockTest [-filter text]\n" );
+	exit( 1 );
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int main( int argc, char ** argv )
+{
+	std::string	filter;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		char const * const	arg		= argv[ i ];
+		bool const			more	= ( i + 1 < argc );
+
+		if ( strcmp( arg, "-filter" ) == 0 && more )
+		{
+			filter = argv[ ++i ];
+		}
+		else
+		{
+			Usage();
+		}
+	}
+
+	typedef bool ( *Body )( HeightField const & terrain );
+
+	struct Test
+	{
+		char const *	m_Name;
+		Body			m_Body;
+	};
+
+	static Test const	tests[] =
+	{
+		{ "GridFindClosest",		TestGridFindClosest		},
+		{ "NeighborKernel",			TestNeighborKernel		},
+		{ "TerrainSampling",		TestTerrainSampling		},
+		{ "GridWrap",				TestGridWrap			},
+		{ "ThreadedUpdate",			TestThreadedUpdate		},
+		{ "IndexModes",				TestIndexModes			},
+		{ "SortKeepsIds",			TestSortKeepsIds		},
+		{ "BoidPool",				TestBoidPool			},
+		{ "Handles",				TestHandles				},
+		{ "HeightFieldMesh",		TestHeightFieldMesh		},
+		{ "Culling",				TestCulling				},
+	};
+
+	HeightField	terrain( TERRAIN_SIZE, TERRAIN_SIZE, XY_SCALE );
+	Scenario::GenerateTerrain( terrain, Z_SCALE );
+
+	int	failures	= 0;
+
+	for ( size_t t = 0; t < sizeof( tests ) / sizeof( tests[ 0 ] ); t++ )
+	{
+		if ( !filter.empty() && strstr( tests[ t ].m_Name, filter.c_str() ) == 0 )
+		{
+			continue;
+		}
+
+		printf( "%s\n", tests[ t ].m_Name );
+		fflush( stdout );
+
+		bool const	passed	= tests[ t ].m_Body( terrain );
+
+		printf( "%s %s\n", passed ? "PASSED" : "FAILED", tests[ t ].m_Name );
+
+		if ( !passed )
+		{
+			++failures;
+		}
+	}
+
+	printf( "%d failed\n", failures );
+
+	return ( failures == 0 ) ? 0 : 1;
+}
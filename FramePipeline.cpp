@@ -0,0 +1,171 @@
+/*****************************************************************************
+
+                               FramePipeline.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FramePipeline.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "FramePipeline.h"
+
+#include <cassert>
+#include <chrono>
+#include "ChromeTrace.h"
+
+namespace
+{
+
+typedef std::chrono::steady_clock	Clock;
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FramePipeline::FramePipeline( Simulation & simulation, float frameTime )
+	: m_Simulation( simulation ),
+	m_FrameTime( frameTime ),
+	m_Quit( false ),
+	m_Running( false ),
+	m_ProducedCount( 0 ),
+	m_ConsumedCount( 0 )
+{
+	assert( frameTime >= 0.f );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FramePipeline::~FramePipeline()
+{
+	Stop();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FramePipeline::Start()
+{
+	if ( m_Thread.joinable() )
+	{
+		return;
+	}
+
+	m_Quit = false;
+	m_Running = true;
+	m_Thread = std::thread( &FramePipeline::SimulationMain, this );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FramePipeline::Stop()
+{
+	if ( !m_Thread.joinable() )
+	{
+		return;
+	}
+
+	m_Quit = true;
+	m_Thread.join();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+FrameSnapshot const * FramePipeline::Acquire()
+{
+	if ( m_Snapshots.Update() )
+	{
+		++m_ConsumedCount;
+	}
+
+	FrameSnapshot const &	snapshot	= m_Snapshots.GetFront();
+
+	return ( snapshot.m_Frame > 0 ) ? &snapshot : 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FramePipeline::SimulationMain()
+{
+	Clock::duration const	frameTime	= std::chrono::duration_cast< Clock::duration >(
+											  std::chrono::duration< float >( m_FrameTime ) );
+	Clock::time_point		last		= Clock::now();
+	Clock::time_point		next		= last + frameTime;
+
+	while ( !m_Quit.load() )
+	{
+		Clock::time_point const	now		= Clock::now();
+		float const				elapsed	= std::chrono::duration< float >( now - last ).count();
+
+		last = now;
+
+		bool	more;
+
+		{
+			ChromeTrace::Scope const	trace( "simulate" );
+
+			more = m_Simulation.Step( elapsed );
+		}
+
+		{
+			ChromeTrace::Scope const	trace( "capture" );
+
+			FrameSnapshot &	snapshot	= m_Snapshots.GetBack();
+
+			m_Simulation.Capture( snapshot );
+			snapshot.m_Frame = ++m_ProducedCount;
+			snapshot.m_Time = now;
+			m_Snapshots.Publish();
+		}
+
+		if ( !more )
+		{
+			break;
+		}
+
+		// Wait for the next frame. If the simulation has fallen behind by more than a frame, it starts over from now
+		// instead of trying to catch up.
+
+		if ( frameTime > Clock::duration::zero() )
+		{
+			Clock::time_point const	done	= Clock::now();
+
+			if ( done < next )
+			{
+				std::this_thread::sleep_until( next );
+				next += frameTime;
+			}
+			else
+			{
+				next = done + frameTime;
+			}
+		}
+	}
+
+	m_Running = false;
+}
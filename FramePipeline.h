@@ -0,0 +1,136 @@
+#if !defined( FRAMEPIPELINE_H_INCLUDED )
+#define FRAMEPIPELINE_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                FramePipeline.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/FramePipeline.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "BoidArrays.h"
+#include "HeightFieldMesh.h"
+#include "TripleBuffer.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The state of the world at the end of a frame of the simulation, with everything that is needed to draw it. A
+// snapshot is not changed once it has been published, until the consumer lets it go.
+//
+// The boids are saved before and after the last step of the flock, so that the consumer can draw them part way
+// between the two at the time that it draws them. The boids that may be seen are found by the simulation thread,
+// which has the flock's grid.
+
+struct FrameSnapshot
+{
+	typedef std::chrono::steady_clock::time_point	Time;
+
+	FrameSnapshot() : m_Frame( 0 ), m_StepTime( 0.f ), m_Alpha( 0.f ), m_SeaLevel( 0. )	{}
+
+	long				m_Frame;			// Number of the frame that produced it, starting at 1 (0 if none has yet)
+	Time				m_Time;				// Time of the state, which is when the frame started
+	BoidArrays			m_PreviousBoids;	// The boids before the last step, by ID
+	BoidArrays			m_CurrentBoids;		// The boids after the last step, by ID
+	std::vector< int >	m_VisibleBoids;		// IDs of the boids that may be seen anywhere between the two
+	float				m_StepTime;			// Length of a step of the flock in seconds
+	float				m_Alpha;			// Fraction of a step past the current boids at m_Time
+	HeightFieldMesh		m_Water;			// The surface of the water, if there is any
+	double				m_SeaLevel;
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Runs a simulation on its own thread and hands the results to another thread (the renderer), so that simulating one
+// frame and drawing the one before overlap instead of taking turns.
+//
+// The simulation thread steps the simulation by the time since its last frame, writes a snapshot of the state, and
+// publishes it. The snapshots are kept in a triple buffer, so the simulation never waits for the consumer, and the
+// consumer never waits for the simulation: Acquire() returns the latest snapshot published, and the consumer can read
+// it until it calls Acquire() again. Snapshots that are published while the consumer is busy are skipped.
+//
+// Nothing the simulation touches may be used by any other thread while the pipeline is running, except through the
+// snapshots.
+
+class FramePipeline
+{
+public:
+
+	// The work done on the simulation thread
+	class Simulation
+	{
+	public:
+		virtual ~Simulation() {}
+
+		// Step the simulation by the time since the last frame. Returns false if there is nothing more to simulate,
+		// which ends the simulation thread.
+		virtual bool	Step( float elapsed ) = 0;
+
+		// Write the state of the simulation into a snapshot. The snapshot holds whatever was written into it the last
+		// time it was used, so only what has changed needs to be written. The frame number and the time are written
+		// by the pipeline.
+		virtual void	Capture( FrameSnapshot & snapshot ) = 0;
+	};
+
+	// The simulation thread produces a frame every frameTime seconds, or as fast as it can if frameTime is 0
+	FramePipeline( Simulation & simulation, float frameTime );
+	virtual ~FramePipeline();
+
+	// Start the simulation thread
+	void					Start();
+
+	// Stop the simulation thread and wait for it to finish its frame
+	void					Stop();
+
+	// Return true if the simulation thread is running
+	bool					IsRunning() const				{ return m_Running.load(); }
+
+	// Return the latest snapshot, or 0 if none has been published yet. The snapshot stays valid and unchanged until
+	// the next call. This never waits (consumer thread only).
+	FrameSnapshot const *	Acquire();
+
+	// Return the number of frames produced by the simulation thread
+	long					GetProducedCount() const		{ return m_ProducedCount.load(); }
+
+	// Return the number of different snapshots returned by Acquire()
+	long					GetConsumedCount() const		{ return m_ConsumedCount; }
+
+private:
+
+	// Prevent copying
+	FramePipeline( FramePipeline const & );
+	FramePipeline & operator =( FramePipeline const & );
+
+	// Thread function for the simulation thread
+	void	SimulationMain();
+
+	Simulation &					m_Simulation;
+	float							m_FrameTime;		// Seconds between frames, or 0
+	TripleBuffer< FrameSnapshot >	m_Snapshots;
+	std::thread						m_Thread;
+	std::atomic< bool >				m_Quit;				// True if the simulation thread should stop
+	std::atomic< bool >				m_Running;			// True until the simulation thread stops
+	std::atomic< long >				m_ProducedCount;
+	long							m_ConsumedCount;	// Consumer thread only
+};
+
+
+#endif // !defined( FRAMEPIPELINE_H_INCLUDED )
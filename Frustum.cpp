@@ -0,0 +1,162 @@
+/*****************************************************************************
+
+                                  Frustum.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/Frustum.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "Frustum.h"
+
+#include <cmath>
+#include <limits>
+#include "Math/Vector3f.h"
+
+namespace
+{
+
+// Make a plane from the coefficients of a row combination of the clip matrix, scaled so that the normal is a unit
+// vector
+
+Frustum::Plane MakePlane( float a, float b, float c, float d )
+{
+	float const		scale	= 1.f / sqrtf( a * a + b * b + c * c );
+	Frustum::Plane	plane;
+
+	plane.m_Normal	= Vector3f( a * scale, b * scale, c * scale );
+	plane.m_D		= d * scale;
+
+	return plane;
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Frustum::Frustum()
+	: m_Eye( 0.f, 0.f, 0.f )
+{
+	// Planes with no normal and a large D have everything on the inside
+
+	for ( int i = 0; i < PLANE_COUNT; i++ )
+	{
+		m_Planes[ i ].m_Normal	= Vector3f( 0.f, 0.f, 0.f );
+		m_Planes[ i ].m_D		= std::numeric_limits< float >::max();
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+Frustum::Frustum( float const * projection, float const * view )
+{
+	Set( projection, view );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Frustum::Set( float const * projection, float const * view )
+{
+	// The clip matrix takes a point in world space to clip space. A point is inside the frustum if -w <= x, y, z <= w
+	// in clip space, and each of those inequalities is a plane in world space (Gribb and Hartmann).
+
+	float	clip[ 16 ];
+
+	for ( int column = 0; column < 4; column++ )
+	{
+		for ( int row = 0; row < 4; row++ )
+		{
+			float	sum	= 0.f;
+
+			for ( int k = 0; k < 4; k++ )
+			{
+				sum += projection[ k * 4 + row ] * view[ column * 4 + k ];
+			}
+
+			clip[ column * 4 + row ] = sum;
+		}
+	}
+
+	float const * const	x	= &clip[ 0 ];	// Columns of the clip matrix
+	float const * const	y	= &clip[ 4 ];
+	float const * const	z	= &clip[ 8 ];
+	float const * const	w	= &clip[ 12 ];
+
+	m_Planes[ PLANE_LEFT ]		= MakePlane( x[ 3 ] + x[ 0 ], y[ 3 ] + y[ 0 ], z[ 3 ] + z[ 0 ], w[ 3 ] + w[ 0 ] );
+	m_Planes[ PLANE_RIGHT ]		= MakePlane( x[ 3 ] - x[ 0 ], y[ 3 ] - y[ 0 ], z[ 3 ] - z[ 0 ], w[ 3 ] - w[ 0 ] );
+	m_Planes[ PLANE_BOTTOM ]	= MakePlane( x[ 3 ] + x[ 1 ], y[ 3 ] + y[ 1 ], z[ 3 ] + z[ 1 ], w[ 3 ] + w[ 1 ] );
+	m_Planes[ PLANE_TOP ]		= MakePlane( x[ 3 ] - x[ 1 ], y[ 3 ] - y[ 1 ], z[ 3 ] - z[ 1 ], w[ 3 ] - w[ 1 ] );
+	m_Planes[ PLANE_NEAR ]		= MakePlane( x[ 3 ] + x[ 2 ], y[ 3 ] + y[ 2 ], z[ 3 ] + z[ 2 ], w[ 3 ] + w[ 2 ] );
+	m_Planes[ PLANE_FAR ]		= MakePlane( x[ 3 ] - x[ 2 ], y[ 3 ] - y[ 2 ], z[ 3 ] - z[ 2 ], w[ 3 ] - w[ 2 ] );
+
+	// The view matrix is a rotation R followed by a translation t, so the eye is at -transpose(R) * t
+
+	float const	tx	= view[ 12 ];
+	float const	ty	= view[ 13 ];
+	float const	tz	= view[ 14 ];
+
+	m_Eye = Vector3f( -( view[ 0 ] * tx + view[ 1 ] * ty + view[ 2 ] * tz ),
+					  -( view[ 4 ] * tx + view[ 5 ] * ty + view[ 6 ] * tz ),
+					  -( view[ 8 ] * tx + view[ 9 ] * ty + view[ 10 ] * tz ) );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Frustum::SetMaxDistance( float distance )
+{
+	// The near plane faces along the direction of view, so the far plane faces the other way
+
+	Vector3f const &	forward	= m_Planes[ PLANE_NEAR ].m_Normal;
+	Plane &				plane	= m_Planes[ PLANE_FAR ];
+
+	plane.m_Normal	= -forward;
+	plane.m_D		= forward.m_X * m_Eye.m_X + forward.m_Y * m_Eye.m_Y + forward.m_Z * m_Eye.m_Z + distance;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool Frustum::IsOutside( Vector3f const & minimum, Vector3f const & maximum, float margin ) const
+{
+	// The box is outside if the corner farthest along the normal of any plane is outside of that plane
+
+	for ( int i = 0; i < PLANE_COUNT; i++ )
+	{
+		Plane const &	plane	= m_Planes[ i ];
+		float const		x		= ( plane.m_Normal.m_X >= 0.f ) ? maximum.m_X : minimum.m_X;
+		float const		y		= ( plane.m_Normal.m_Y >= 0.f ) ? maximum.m_Y : minimum.m_Y;
+		float const		z		= ( plane.m_Normal.m_Z >= 0.f ) ? maximum.m_Z : minimum.m_Z;
+		float const		d		= plane.m_Normal.m_X * x +
+								  plane.m_Normal.m_Y * y +
+								  plane.m_Normal.m_Z * z + plane.m_D;
+
+		if ( d < -margin )
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
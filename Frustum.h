@@ -0,0 +1,104 @@
+#if !defined( FRUSTUM_H_INCLUDED )
+#define FRUSTUM_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                   Frustum.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/Frustum.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "Math/Vector3f.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The volume seen by a camera, as 6 planes in world space.
+//
+// The planes are taken from the camera's projection and view matrices (in the column-major order used by OpenGL), so
+// any camera that can load its matrices into OpenGL can be described. The far plane can be moved closer, so that
+// things beyond a distance are culled along with the things outside of the view.
+
+class Frustum
+{
+public:
+
+	// The planes
+	enum
+	{
+		PLANE_LEFT,
+		PLANE_RIGHT,
+		PLANE_BOTTOM,
+		PLANE_TOP,
+		PLANE_NEAR,
+		PLANE_FAR,
+		PLANE_COUNT
+	};
+
+	// A plane. A point p is on the inside if m_Normal . p + m_D >= 0. The normal is a unit vector, so the value is the
+	// distance to the plane.
+	struct Plane
+	{
+		Vector3f	m_Normal;
+		float		m_D;
+	};
+
+	// Construct a frustum that contains everything
+	Frustum();
+
+	// Construct a frustum from a projection matrix and a view matrix
+	Frustum( float const * projection, float const * view );
+
+	// Set the planes from a projection matrix and a view matrix
+	void			Set( float const * projection, float const * view );
+
+	// Move the far plane to the given distance from the eye, along the direction of view
+	void			SetMaxDistance( float distance );
+
+	// Return the position of the eye
+	Vector3f const &	GetEye() const						{ return m_Eye; }
+
+	// Return a plane
+	Plane const &	GetPlane( int i ) const					{ return m_Planes[ i ]; }
+
+	// Return true if the sphere is entirely outside of the frustum
+	bool			IsOutside( Vector3f const & center, float radius ) const
+	{
+		for ( int i = 0; i < PLANE_COUNT; i++ )
+		{
+			Plane const &	plane	= m_Planes[ i ];
+			float const		d		= plane.m_Normal.m_X * center.m_X +
+									  plane.m_Normal.m_Y * center.m_Y +
+									  plane.m_Normal.m_Z * center.m_Z + plane.m_D;
+
+			if ( d < -radius )
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Return true if the box, grown by margin in every direction, is entirely outside of the frustum. A box is not
+	// always found to be outside when it is, but a box found to be outside never overlaps the frustum.
+	bool			IsOutside( Vector3f const & minimum, Vector3f const & maximum, float margin ) const;
+
+private:
+
+	Plane		m_Planes[ PLANE_COUNT ];
+	Vector3f	m_Eye;			// Position of the eye
+};
+
+
+#endif // !defined( FRUSTUM_H_INCLUDED )
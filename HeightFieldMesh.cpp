@@ -0,0 +1,119 @@
+/*****************************************************************************
+
+                              HeightFieldMesh.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/HeightFieldMesh.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "HeightFieldMesh.h"
+
+#include <cassert>
+#include "Math/Vector3f.h"
+#include "Heightfield/Heightfield.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldMesh::HeightFieldMesh()
+	: m_SizeX( 0 ),
+	m_SizeY( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldMesh::Build( HeightField const & heightField, float xyScale, float texCoordScale )
+{
+	int const	sx	= heightField.GetSizeX();
+	int const	sy	= heightField.GetSizeY();
+	float const	x0	= -( sx - 1 ) * .5f * xyScale;
+	float const	y0	= -( sy - 1 ) * .5f * xyScale;
+
+	m_SizeX = sx;
+	m_SizeY = sy;
+
+	// The texture coordinates, X, and Y never change
+
+	m_Vertices.resize( sx * sy );
+
+	for ( int i = 0; i < sy; i++ )
+	{
+		for ( int j = 0; j < sx; j++ )
+		{
+			Vertex &	v	= m_Vertices[ i * sx + j ];
+
+			v.m_TexCoord[ 0 ]	= float( j ) * texCoordScale;
+			v.m_TexCoord[ 1 ]	= float( i ) * texCoordScale;
+			v.m_Position[ 0 ]	= x0 + j * xyScale;
+			v.m_Position[ 1 ]	= y0 + i * xyScale;
+		}
+	}
+
+	UpdateHeights( heightField );
+
+	// Two triangles for each square. With a the point at (j, i) and b the point at (j, i + 1), they are (b, a, b + 1)
+	// and (b + 1, a, a + 1), which are the triangles of a strip alternating between b and a.
+
+	m_Indices.clear();
+
+	if ( sx < 2 || sy < 2 )
+	{
+		return;
+	}
+
+	m_Indices.reserve( ( sx - 1 ) * ( sy - 1 ) * 6 );
+
+	for ( int i = 0; i < sy - 1; i++ )
+	{
+		for ( int j = 0; j < sx - 1; j++ )
+		{
+			unsigned int const	a	= i * sx + j;
+			unsigned int const	b	= a + sx;
+
+			m_Indices.push_back( b );
+			m_Indices.push_back( a );
+			m_Indices.push_back( b + 1 );
+
+			m_Indices.push_back( b + 1 );
+			m_Indices.push_back( a );
+			m_Indices.push_back( a + 1 );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldMesh::UpdateHeights( HeightField const & heightField )
+{
+	assert( heightField.GetSizeX() == m_SizeX && heightField.GetSizeY() == m_SizeY );
+
+	int const							n		= m_SizeX * m_SizeY;
+	HeightField::Vertex const * const	pData	= heightField.GetData();
+
+	for ( int i = 0; i < n; i++ )
+	{
+		Vertex &					v	= m_Vertices[ i ];
+		HeightField::Vertex const &	h	= pData[ i ];
+
+		v.m_Normal[ 0 ]		= h.m_Normal.m_X;
+		v.m_Normal[ 1 ]		= h.m_Normal.m_Y;
+		v.m_Normal[ 2 ]		= h.m_Normal.m_Z;
+		v.m_Position[ 2 ]	= h.m_Z;
+	}
+}
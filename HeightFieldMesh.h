@@ -0,0 +1,83 @@
+#if !defined( HEIGHTFIELDMESH_H_INCLUDED )
+#define HEIGHTFIELDMESH_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                               HeightFieldMesh.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/HeightFieldMesh.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+
+class HeightField;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// An indexed triangle mesh of a height field, in arrays that can be handed to a renderer as they are.
+//
+// The vertices are interleaved in the layout of GL_T2F_N3F_V3F, so the whole mesh can be drawn with
+// glInterleavedArrays() and one glDrawElements( GL_TRIANGLES, ... ). There is one vertex for each point of the height
+// field, in the same order, and the field is centered on the origin. The triangles face up (counterclockwise when
+// seen from above).
+//
+// Only the heights and normals of a height field such as the water change from frame to frame, so UpdateHeights()
+// rewrites only those, and the texture coordinates, X and Y, and the indices are left as they are.
+
+class HeightFieldMesh
+{
+public:
+
+	// A vertex, in the layout of GL_T2F_N3F_V3F
+	struct Vertex
+	{
+		float	m_TexCoord[ 2 ];
+		float	m_Normal[ 3 ];
+		float	m_Position[ 3 ];
+	};
+
+	HeightFieldMesh();
+
+	// Build the mesh. The points are xyScale apart, and the texture coordinates are texCoordScale apart.
+	void					Build( HeightField const & heightField, float xyScale, float texCoordScale );
+
+	// Copy the heights and normals of the height field, which must be the same size as the one the mesh was built from
+	void					UpdateHeights( HeightField const & heightField );
+
+	// Return the vertices
+	Vertex const *			GetVertices() const			{ return m_Vertices.empty() ? 0 : &m_Vertices[ 0 ]; }
+
+	// Return the number of vertices
+	int						GetVertexCount() const		{ return int( m_Vertices.size() ); }
+
+	// Return the indices of the vertices of the triangles, 3 per triangle
+	unsigned int const *	GetIndices() const			{ return m_Indices.empty() ? 0 : &m_Indices[ 0 ]; }
+
+	// Return the number of indices
+	int						GetIndexCount() const		{ return int( m_Indices.size() ); }
+
+	// Return the number of points in each direction
+	int						GetSizeX() const			{ return m_SizeX; }
+	int						GetSizeY() const			{ return m_SizeY; }
+
+private:
+
+	int								m_SizeX;
+	int								m_SizeY;
+	std::vector< Vertex >			m_Vertices;
+	std::vector< unsigned int >		m_Indices;
+};
+
+
+#endif // !defined( HEIGHTFIELDMESH_H_INCLUDED )
@@ -0,0 +1,139 @@
+/*****************************************************************************
+
+                                MortonOrder.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/MortonOrder.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "MortonOrder.h"
+
+#include <vector>
+#include "BoidArrays.h"
+
+namespace
+{
+
+// Number of cells on each side of the lattice
+int const	CELLS			= 1 << MortonOrder::CELL_BITS;
+
+// The codes are sorted CELL_BITS bits at a time, so there are 2 passes
+int const	RADIX_BITS		= MortonOrder::CELL_BITS;
+int const	RADIX			= 1 << RADIX_BITS;
+int const	RADIX_PASSES	= 2;
+
+
+// Spread the low 16 bits of a value out into the even bits
+
+unsigned int SpreadBits( unsigned int v )
+{
+	v &= 0x0000ffff;
+	v = ( v | ( v << 8 ) ) & 0x00ff00ff;
+	v = ( v | ( v << 4 ) ) & 0x0f0f0f0f;
+	v = ( v | ( v << 2 ) ) & 0x33333333;
+	v = ( v | ( v << 1 ) ) & 0x55555555;
+	return v;
+}
+
+
+// Return the cell containing a coordinate, clamped to the lattice
+
+unsigned int CellOf( float v, float origin, float scale )
+{
+	float const	c	= ( v - origin ) * scale;
+
+	if ( !( c >= 0.f ) )
+	{
+		return 0;
+	}
+	if ( c >= float( CELLS - 1 ) )
+	{
+		return CELLS - 1;
+	}
+	return ( unsigned int )( c );
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+unsigned int MortonOrder::Encode( unsigned int x, unsigned int y )
+{
+	return SpreadBits( x ) | ( SpreadBits( y ) << 1 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void MortonOrder::Sort( BoidArrays const & boids, float sizeX, float sizeY, std::vector< int > & order,
+						Workspace & workspace )
+{
+	int const	n		= boids.Size();
+	float const	originX	= -sizeX * .5f;
+	float const	originY	= -sizeY * .5f;
+	float const	scaleX	= ( sizeX > 0.f ) ? CELLS / sizeX : 0.f;
+	float const	scaleY	= ( sizeY > 0.f ) ? CELLS / sizeY : 0.f;
+
+	std::vector< unsigned int > &	codes	= workspace.m_Codes;
+
+	codes.resize( n );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		codes[ i ] = Encode( CellOf( boids.m_X[ i ], originX, scaleX ), CellOf( boids.m_Y[ i ], originY, scaleY ) );
+	}
+
+	// Least significant digit first. Each pass is stable, so the boids in a cell stay in index order.
+
+	std::vector< int > &	from	= workspace.m_From;
+	std::vector< int > &	count	= workspace.m_Count;
+
+	from.resize( n );
+	order.resize( n );
+
+	for ( int i = 0; i < n; i++ )
+	{
+		order[ i ] = i;
+	}
+
+	for ( int pass = 0; pass < RADIX_PASSES; pass++ )
+	{
+		int const	shift	= pass * RADIX_BITS;
+
+		from.swap( order );
+		count.assign( RADIX, 0 );
+
+		for ( int i = 0; i < n; i++ )
+		{
+			++count[ ( codes[ i ] >> shift ) & ( RADIX - 1 ) ];
+		}
+
+		int	start	= 0;
+
+		for ( int d = 0; d < RADIX; d++ )
+		{
+			int const	c	= count[ d ];
+
+			count[ d ] = start;
+			start += c;
+		}
+
+		for ( int i = 0; i < n; i++ )
+		{
+			int const	index	= from[ i ];
+
+			order[ count[ ( codes[ index ] >> shift ) & ( RADIX - 1 ) ]++ ] = index;
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#if !defined( MORTONORDER_H_INCLUDED )
+#define MORTONORDER_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                 MortonOrder.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/MortonOrder.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+
+class BoidArrays;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Ordering of boids along a Z-curve (Morton order) through a lattice of cells in the XY plane. Boids that are near each
+// other are mostly near each other in the order, so storing them in this order improves the locality of the neighbor
+// searches.
+
+namespace MortonOrder
+{
+
+// Number of bits in each coordinate of a cell. The lattice is 2^CELL_BITS cells on each side.
+int const	CELL_BITS	= 10;
+
+// Memory used by Sort(). It is kept by the caller so that sorting the same number of boids again allocates nothing.
+struct Workspace
+{
+	std::vector< unsigned int >	m_Codes;	// Morton code of each boid
+	std::vector< int >			m_From;		// Order before each pass
+	std::vector< int >			m_Count;	// Number of codes with each digit, and then the start of each digit
+};
+
+// Return the Morton code of a cell: the bits of x and y interleaved, with x in the even bits
+unsigned int	Encode( unsigned int x, unsigned int y );
+
+// Find the order of the boids along the Z-curve through a lattice covering an area centered on the origin. order[ i ]
+// is the index of the boid that goes i-th. Boids outside of the area are placed in the nearest edge cell, and boids in
+// the same cell keep their relative order. The sort is a radix sort, so the time is linear in the number of boids.
+void			Sort( BoidArrays const & boids, float sizeX, float sizeY, std::vector< int > & order,
+					  Workspace & workspace );
+
+} // namespace MortonOrder
+
+
+#endif // !defined( MORTONORDER_H_INCLUDED )
@@ -0,0 +1,351 @@
+/*****************************************************************************
+
+                              NeighborKernel.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/NeighborKernel.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "NeighborKernel.h"
+
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+#define NEIGHBORKERNEL_X86
+#endif
+
+#if defined( NEIGHBORKERNEL_X86 )
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif // defined( NEIGHBORKERNEL_X86 )
+
+// MSVC allows any intrinsics in any function. GCC and Clang must be told which functions use them.
+
+#if defined( _MSC_VER )
+#define NEIGHBORKERNEL_TARGET_SSE2
+#define NEIGHBORKERNEL_TARGET_AVX2
+#else
+#define NEIGHBORKERNEL_TARGET_SSE2	__attribute__(( target( "sse2" ) ))
+#define NEIGHBORKERNEL_TARGET_AVX2	__attribute__(( target( "avx2" ) ))
+#endif
+
+namespace
+{
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Update the best candidate. Ties go to the lowest id.
+
+inline void Consider( float distance2, int id, float & bestDistance2, int & bestId )
+{
+	if ( distance2 < bestDistance2 || ( distance2 == bestDistance2 && id < bestId ) )
+	{
+		bestDistance2 = distance2;
+		bestId = id;
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void FindClosestScalar( float const * x, float const * y, float const * z, int const * id, int count,
+						float px, float py, float pz,
+						float & bestDistance2, int & bestId )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		float const	dx	= x[ i ] - px;
+		float const	dy	= y[ i ] - py;
+		float const	dz	= z[ i ] - pz;
+
+		Consider( ( dx * dx + dy * dy ) + dz * dz, id[ i ], bestDistance2, bestId );
+	}
+}
+
+
+#if defined( NEIGHBORKERNEL_X86 )
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NEIGHBORKERNEL_TARGET_SSE2
+void FindClosestSse2( float const * x, float const * y, float const * z, int const * id, int count,
+					  float px, float py, float pz,
+					  float & bestDistance2, int & bestId )
+{
+	__m128 const	px4		= _mm_set1_ps( px );
+	__m128 const	py4		= _mm_set1_ps( py );
+	__m128 const	pz4		= _mm_set1_ps( pz );
+	__m128			best	= _mm_set1_ps( bestDistance2 );
+	__m128i			bestI	= _mm_set1_epi32( bestId );
+
+	int	i	= 0;
+
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128 const	dx		= _mm_sub_ps( _mm_loadu_ps( x + i ), px4 );
+		__m128 const	dy		= _mm_sub_ps( _mm_loadu_ps( y + i ), py4 );
+		__m128 const	dz		= _mm_sub_ps( _mm_loadu_ps( z + i ), pz4 );
+		__m128 const	d2		= _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ), _mm_mul_ps( dz, dz ) );
+		__m128i const	ids		= _mm_loadu_si128( reinterpret_cast< __m128i const * >( id + i ) );
+
+		__m128 const	closer	= _mm_cmplt_ps( d2, best );
+		__m128 const	tied	= _mm_and_ps( _mm_cmpeq_ps( d2, best ), _mm_castsi128_ps( _mm_cmplt_epi32( ids, bestI ) ) );
+		__m128 const	mask	= _mm_or_ps( closer, tied );
+
+		best	= _mm_or_ps( _mm_and_ps( mask, d2 ), _mm_andnot_ps( mask, best ) );
+		bestI	= _mm_or_si128( _mm_and_si128( _mm_castps_si128( mask ), ids ),
+								_mm_andnot_si128( _mm_castps_si128( mask ), bestI ) );
+	}
+
+	// Reduce the lanes
+
+	float	lanes[ 4 ];
+	int		laneIds[ 4 ];
+
+	_mm_storeu_ps( lanes, best );
+	_mm_storeu_si128( reinterpret_cast< __m128i * >( laneIds ), bestI );
+
+	for ( int j = 0; j < 4; j++ )
+	{
+		Consider( lanes[ j ], laneIds[ j ], bestDistance2, bestId );
+	}
+
+	// Finish the remainder
+
+	FindClosestScalar( x + i, y + i, z + i, id + i, count - i, px, py, pz, bestDistance2, bestId );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NEIGHBORKERNEL_TARGET_AVX2
+void FindClosestAvx2( float const * x, float const * y, float const * z, int const * id, int count,
+					  float px, float py, float pz,
+					  float & bestDistance2, int & bestId )
+{
+	__m256 const	px8		= _mm256_set1_ps( px );
+	__m256 const	py8		= _mm256_set1_ps( py );
+	__m256 const	pz8		= _mm256_set1_ps( pz );
+	__m256			best	= _mm256_set1_ps( bestDistance2 );
+	__m256i			bestI	= _mm256_set1_epi32( bestId );
+
+	int	i	= 0;
+
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m256 const	dx		= _mm256_sub_ps( _mm256_loadu_ps( x + i ), px8 );
+		__m256 const	dy		= _mm256_sub_ps( _mm256_loadu_ps( y + i ), py8 );
+		__m256 const	dz		= _mm256_sub_ps( _mm256_loadu_ps( z + i ), pz8 );
+		__m256 const	d2		= _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( dx, dx ), _mm256_mul_ps( dy, dy ) ),
+												 _mm256_mul_ps( dz, dz ) );
+		__m256i const	ids		= _mm256_loadu_si256( reinterpret_cast< __m256i const * >( id + i ) );
+
+		__m256 const	closer	= _mm256_cmp_ps( d2, best, _CMP_LT_OQ );
+		__m256 const	tied	= _mm256_and_ps( _mm256_cmp_ps( d2, best, _CMP_EQ_OQ ),
+												 _mm256_castsi256_ps( _mm256_cmpgt_epi32( bestI, ids ) ) );
+		__m256 const	mask	= _mm256_or_ps( closer, tied );
+
+		best	= _mm256_blendv_ps( best, d2, mask );
+		bestI	= _mm256_castps_si256( _mm256_blendv_ps( _mm256_castsi256_ps( bestI ), _mm256_castsi256_ps( ids ), mask ) );
+	}
+
+	// Reduce the lanes
+
+	float	lanes[ 8 ];
+	int		laneIds[ 8 ];
+
+	_mm256_storeu_ps( lanes, best );
+	_mm256_storeu_si256( reinterpret_cast< __m256i * >( laneIds ), bestI );
+
+	// Avoid the penalty for mixing AVX and SSE code in the caller. Not all compilers do this automatically.
+
+	_mm256_zeroupper();
+
+	for ( int j = 0; j < 8; j++ )
+	{
+		Consider( lanes[ j ], laneIds[ j ], bestDistance2, bestId );
+	}
+
+	// Finish the remainder
+
+	FindClosestScalar( x + i, y + i, z + i, id + i, count - i, px, py, pz, bestDistance2, bestId );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Cpuid( int leaf, int subleaf, unsigned int regs[ 4 ] )
+{
+#if defined( _MSC_VER )
+	int	r[ 4 ];
+	__cpuidex( r, leaf, subleaf );
+	regs[ 0 ] = r[ 0 ]; regs[ 1 ] = r[ 1 ]; regs[ 2 ] = r[ 2 ]; regs[ 3 ] = r[ 3 ];
+#else
+	__cpuid_count( leaf, subleaf, regs[ 0 ], regs[ 1 ], regs[ 2 ], regs[ 3 ] );
+#endif
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Return the OS-enabled extended state bits (XCR0)
+
+unsigned long long Xgetbv()
+{
+#if defined( _MSC_VER )
+	return _xgetbv( 0 );
+#else
+	unsigned int	eax;
+	unsigned int	edx;
+	__asm__ __volatile__( "xgetbv" : "=a"( eax ), "=d"( edx ) : "c"( 0 ) );
+	return ( ( unsigned long long )edx << 32 ) | eax;
+#endif
+}
+
+#endif // defined( NEIGHBORKERNEL_X86 )
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NeighborKernel::Level DetectLevel()
+{
+#if defined( NEIGHBORKERNEL_X86 )
+
+	unsigned int	regs[ 4 ];
+
+	Cpuid( 0, 0, regs );
+	unsigned int const	maxLeaf	= regs[ 0 ];
+
+	Cpuid( 1, 0, regs );
+	bool const	sse2	= ( regs[ 3 ] & ( 1u << 26 ) ) != 0;
+	bool const	osxsave	= ( regs[ 2 ] & ( 1u << 27 ) ) != 0;
+	bool const	avx		= ( regs[ 2 ] & ( 1u << 28 ) ) != 0;
+
+	// AVX2 requires the OS to save the YMM registers
+
+	if ( maxLeaf >= 7 && osxsave && avx && ( Xgetbv() & 6 ) == 6 )
+	{
+		Cpuid( 7, 0, regs );
+		if ( ( regs[ 1 ] & ( 1u << 5 ) ) != 0 )
+		{
+			return NeighborKernel::LEVEL_AVX2;
+		}
+	}
+
+	if ( sse2 )
+	{
+		return NeighborKernel::LEVEL_SSE2;
+	}
+
+#endif // defined( NEIGHBORKERNEL_X86 )
+
+	return NeighborKernel::LEVEL_SCALAR;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NeighborKernel::Level & CurrentLevel()
+{
+	static NeighborKernel::Level	level	= NeighborKernel::GetSupportedLevel();
+
+	return level;
+}
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NeighborKernel::Level NeighborKernel::GetLevel()
+{
+	return CurrentLevel();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NeighborKernel::Level NeighborKernel::GetSupportedLevel()
+{
+	static Level const	supported	= DetectLevel();
+
+	return supported;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+NeighborKernel::Level NeighborKernel::SetLevel( Level level )
+{
+	CurrentLevel() = ( level <= GetSupportedLevel() ) ? level : GetSupportedLevel();
+
+	return CurrentLevel();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void NeighborKernel::FindClosest( float const * x, float const * y, float const * z, int const * id, int count,
+								  float px, float py, float pz,
+								  float & bestDistance2, int & bestId )
+{
+	switch ( CurrentLevel() )
+	{
+#if defined( NEIGHBORKERNEL_X86 )
+	case LEVEL_AVX2:
+		FindClosestAvx2( x, y, z, id, count, px, py, pz, bestDistance2, bestId );
+		break;
+
+	case LEVEL_SSE2:
+		FindClosestSse2( x, y, z, id, count, px, py, pz, bestDistance2, bestId );
+		break;
+#endif // defined( NEIGHBORKERNEL_X86 )
+
+	default:
+		FindClosestScalar( x, y, z, id, count, px, py, pz, bestDistance2, bestId );
+		break;
+	}
+}
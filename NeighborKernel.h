@@ -0,0 +1,59 @@
+#if !defined( NEIGHBORKERNEL_H_INCLUDED )
+#define NEIGHBORKERNEL_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                               NeighborKernel.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/NeighborKernel.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Vectorized search for the closest of a contiguous set of positions. The implementation is chosen at run-time
+// according to the instruction sets supported by the CPU. All implementations return identical results.
+
+namespace NeighborKernel
+{
+
+// Instruction sets
+enum Level
+{
+	LEVEL_SCALAR,
+	LEVEL_SSE2,
+	LEVEL_AVX2
+};
+
+// Return the instruction set in use
+Level	GetLevel();
+
+// Return the best instruction set supported by the CPU
+Level	GetSupportedLevel();
+
+// Use the given instruction set (or the best supported one, if it is not supported) and return the one in use
+Level	SetLevel( Level level );
+
+// Find the closest of the given candidates to the point (px, py, pz).
+//
+// A candidate replaces the current best if its squared distance is less than bestDistance2, or if it is equal and its
+// id is lower than bestId. To find the closest candidate within a distance d, set bestDistance2 to d*d and bestId to
+// -1 before the first call. The values are updated in place, so a search may span several calls.
+void	FindClosest( float const * x, float const * y, float const * z, int const * id, int count,
+					 float px, float py, float pz,
+					 float & bestDistance2, int & bestId );
+
+} // namespace NeighborKernel
+
+
+#endif // !defined( NEIGHBORKERNEL_H_INCLUDED )
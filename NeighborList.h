@@ -0,0 +1,66 @@
+#if !defined( NEIGHBORLIST_H_INCLUDED )
+#define NEIGHBORLIST_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                NeighborList.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/NeighborList.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The results of a neighbor query. The storage is owned by the caller and allocated in advance by Reserve(), so a
+// query never allocates memory. A query stores at most GetCapacity() neighbors.
+
+class NeighborList
+{
+public:
+
+	struct Neighbor
+	{
+		int		m_Index;		// Index of the boid
+		float	m_Distance2;	// Squared distance to the boid
+	};
+
+	NeighborList( int capacity = 0 ) : m_Size( 0 )	{ Reserve( capacity ); }
+
+	// Set the maximum number of neighbors that a query can store
+	void				Reserve( int capacity )		{ m_Neighbors.resize( capacity ); if ( m_Size > capacity ) m_Size = capacity; }
+
+	// Return the maximum number of neighbors that a query can store
+	int					GetCapacity() const			{ return int( m_Neighbors.size() ); }
+
+	// Return the number of neighbors stored
+	int					Size() const				{ return m_Size; }
+
+	// Return a neighbor
+	Neighbor const &	operator []( int i ) const	{ return m_Neighbors[ i ]; }
+
+	// Remove all neighbors
+	void				Clear()						{ m_Size = 0; }
+
+private:
+
+	friend class BoidGrid;
+	friend class Flock;
+
+	std::vector< Neighbor >	m_Neighbors;
+	int						m_Size;
+};
+
+
+#endif // !defined( NEIGHBORLIST_H_INCLUDED )
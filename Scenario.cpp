@@ -0,0 +1,81 @@
+/*****************************************************************************
+
+                                 Scenario.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/Scenario.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "Scenario.h"
+
+#include <cmath>
+#include "Misc/Random.h"
+#include "Math/Vector3f.h"
+#include "Heightfield/Heightfield.h"
+
+#include "Boid.h"
+#include "Flock.h"
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Scenario::GenerateTerrain( HeightField & terrain, float zScale )
+{
+	for ( int y = 0; y < terrain.GetSizeY(); y++ )
+	{
+		for ( int x = 0; x < terrain.GetSizeX(); x++ )
+		{
+			float const	z	= .5f
+							+ .25f * sinf( x * .05f ) * cosf( y * .07f )
+							+ .125f * sinf( x * .23f + y * .17f );
+
+			terrain.GetData( x, y )->m_Z = z * zScale;
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Scenario::SpawnBoids( Flock & flock, int n, Distribution distribution,
+						   HeightField const & terrain, float xyScale, unsigned int seed )
+{
+	RandomFloat	random( seed );
+
+	float const	halfX	= ( distribution == CLUSTERED ) ? 5.f * xyScale : ( terrain.GetSizeX() - 1.f ) * xyScale * .5f;
+	float const	halfY	= ( distribution == CLUSTERED ) ? 5.f * xyScale : ( terrain.GetSizeY() - 1.f ) * xyScale * .5f;
+
+	for ( int i = 0; i < n; i++ )
+	{
+		Vector3f const	position( random.Next( -halfX, halfX ),
+								  random.Next( -halfY, halfY ),
+								  random.Next(  0.f, 1.f ) );
+
+		Vector3f const	velocity( random.Next( -1.f, 1.f ) * Boid::DESIRED_SPEED,
+								  random.Next( -1.f, 1.f ) * Boid::DESIRED_SPEED,
+								  random.Next( -.1f, .1f ) * Boid::DESIRED_SPEED );
+
+		flock.Add( position, velocity );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void Scenario::DeleteBoids( Flock & flock )
+{
+	flock.RemoveAll();
+}
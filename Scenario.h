@@ -0,0 +1,53 @@
+#if !defined( SCENARIO_H_INCLUDED )
+#define SCENARIO_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                  Scenario.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/Scenario.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+class HeightField;
+class Flock;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Terrain and flocks for the programs that run the simulation without a window (the driver, the benchmarks, and the
+// tests)
+
+namespace Scenario
+{
+
+// Where the boids start
+enum Distribution
+{
+	CLUSTERED,	// In a 10 x 10 box at the center of the terrain, as in the Flock demo
+	UNIFORM		// Spread over the whole terrain
+};
+
+// Fill the terrain with rolling hills between about 1/8 and 7/8 of zScale
+void	GenerateTerrain( HeightField & terrain, float zScale );
+
+// Add n boids to the flock with Flock::Add()
+void	SpawnBoids( Flock & flock, int n, Distribution distribution,
+					HeightField const & terrain, float xyScale, unsigned int seed );
+
+// Remove all of the boids from the flock
+void	DeleteBoids( Flock & flock );
+
+} // namespace Scenario
+
+
+#endif // !defined( SCENARIO_H_INCLUDED )
@@ -0,0 +1,357 @@
+/*****************************************************************************
+
+                               TerrainCache.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/TerrainCache.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "TerrainCache.h"
+
+#include <vector>
+#include <cmath>
+#include "Math/Vector3f.h"
+#include "Heightfield/Heightfield.h"
+
+#include "NeighborKernel.h"
+
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+#define TERRAINCACHE_X86
+#include <immintrin.h>
+#endif
+
+// MSVC allows any intrinsics in any function. GCC and Clang must be told which functions use them.
+
+#if defined( _MSC_VER )
+#define TERRAINCACHE_TARGET_AVX2
+#else
+#define TERRAINCACHE_TARGET_AVX2	__attribute__(( target( "avx2" ) ))
+#endif
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+TerrainCache::TerrainCache()
+	: m_pTerrain( 0 ),
+	m_SizeX( 0 ),
+	m_SizeY( 0 ),
+	m_XYScale( 0.f ),
+	m_InverseXYScale( 0.f ),
+	m_SeaLevel( 0.f ),
+	m_IsValid( false )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+TerrainCache::~TerrainCache()
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool TerrainCache::Refresh( HeightField const & terrain, float xyScale, float seaLevel )
+{
+	if ( m_IsValid &&
+		 &terrain == m_pTerrain &&
+		 terrain.GetSizeX() == m_SizeX &&
+		 terrain.GetSizeY() == m_SizeY &&
+		 xyScale == m_XYScale &&
+		 seaLevel == m_SeaLevel )
+	{
+		return false;
+	}
+
+	m_pTerrain			= &terrain;
+	m_SizeX				= terrain.GetSizeX();
+	m_SizeY				= terrain.GetSizeY();
+	m_XYScale			= xyScale;
+	m_InverseXYScale	= 1.f / xyScale;
+	m_SeaLevel			= seaLevel;
+
+	int const	n	= m_SizeX * m_SizeY;
+
+	m_Heights.resize( n );
+	m_WaterMask.assign( ( n + 31 ) / 32, 0 );
+
+	for ( int y = 0; y < m_SizeY; y++ )
+	{
+		for ( int x = 0; x < m_SizeX; x++ )
+		{
+			int const	i	= y * m_SizeX + x;
+			float const	z	= terrain.GetZ( x, y );
+
+			m_Heights[ i ] = z;
+
+			// Same test as Boid::OverWater
+
+			if ( seaLevel - z <= 0.f )
+			{
+				m_WaterMask[ i >> 5 ] |= 1u << ( i & 31 );
+			}
+		}
+	}
+
+	m_IsValid = true;
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int TerrainCache::GetIndex( Vector3f const & position ) const
+{
+	// Same computation as Boid::AvoidTerrain, so that the same point is found for any scale. A multiply by the inverse
+	// of the scale would round differently near halfway between two points unless the scale is a power of 2.
+
+	int	tx	= int( position.m_X / m_XYScale + ( m_SizeX - 1.f ) * .5f + .5f );
+	int	ty	= int( position.m_Y / m_XYScale + ( m_SizeY - 1.f ) * .5f + .5f );
+
+	if ( tx < 0 )
+	{
+		tx = 0;
+	}
+	else if ( tx > m_SizeX - 1 )
+	{
+		tx = m_SizeX - 1;
+	}
+
+	if ( ty < 0 )
+	{
+		ty = 0;
+	}
+	else if ( ty > m_SizeY - 1 )
+	{
+		ty = m_SizeY - 1;
+	}
+
+	return ty * m_SizeX + tx;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void TerrainCache::SampleHeights( float const * x, float const * y, int count, float * heights, Sampling sampling ) const
+{
+	// The vectorized versions do as many as they can in groups of 8 and the rest are done one at a time
+
+	int	done	= 0;
+
+	if ( NeighborKernel::GetLevel() == NeighborKernel::LEVEL_AVX2 )
+	{
+		done = ( sampling == SAMPLE_BILINEAR ) ? SampleBilinearAvx2( x, y, count, heights )
+											   : SampleNearestAvx2( x, y, count, heights );
+	}
+
+	if ( sampling == SAMPLE_BILINEAR )
+	{
+		SampleBilinear( x, y, done, count, heights );
+	}
+	else
+	{
+		SampleNearest( x, y, done, count, heights );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void TerrainCache::SampleNearest( float const * x, float const * y, int begin, int count, float * heights ) const
+{
+	for ( int i = begin; i < count; i++ )
+	{
+		heights[ i ] = m_Heights[ GetIndex( Vector3f( x[ i ], y[ i ], 0.f ) ) ];
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void TerrainCache::SampleBilinear( float const * x, float const * y, int begin, int count, float * heights ) const
+{
+	float const	maxU	= m_SizeX - 1.f;
+	float const	maxV	= m_SizeY - 1.f;
+
+	for ( int i = begin; i < count; i++ )
+	{
+		// Find the point below and to the left of the position and the position's offset from it. At the far edges,
+		// the point is one back from the edge and the offset is 1.
+
+		float	u	= x[ i ] * m_InverseXYScale + maxU * .5f;
+		float	v	= y[ i ] * m_InverseXYScale + maxV * .5f;
+
+		u = ( u > 0.f ) ? ( ( u < maxU ) ? u : maxU ) : 0.f;
+		v = ( v > 0.f ) ? ( ( v < maxV ) ? v : maxV ) : 0.f;
+
+		int const	tx	= ( int( u ) < m_SizeX - 2 ) ? int( u ) : m_SizeX - 2;
+		int const	ty	= ( int( v ) < m_SizeY - 2 ) ? int( v ) : m_SizeY - 2;
+		float const	fx	= u - tx;
+		float const	fy	= v - ty;
+
+		float const * const	p	= &m_Heights[ ty * m_SizeX + tx ];
+
+		float const	h0	= p[ 0 ] + ( p[ 1 ] - p[ 0 ] ) * fx;
+		float const	h1	= p[ m_SizeX ] + ( p[ m_SizeX + 1 ] - p[ m_SizeX ] ) * fx;
+
+		heights[ i ] = h0 + ( h1 - h0 ) * fy;
+	}
+}
+
+
+#if defined( TERRAINCACHE_X86 )
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+TERRAINCACHE_TARGET_AVX2
+int TerrainCache::SampleNearestAvx2( float const * x, float const * y, int count, float * heights ) const
+{
+	// The same computation as GetIndex(), 8 at a time. Converting with truncation matches int().
+
+	__m256 const	scale	= _mm256_set1_ps( m_XYScale );
+	__m256 const	halfX	= _mm256_set1_ps( ( m_SizeX - 1.f ) * .5f );
+	__m256 const	halfY	= _mm256_set1_ps( ( m_SizeY - 1.f ) * .5f );
+	__m256 const	half	= _mm256_set1_ps( .5f );
+	__m256i const	zero	= _mm256_setzero_si256();
+	__m256i const	maxX	= _mm256_set1_epi32( m_SizeX - 1 );
+	__m256i const	maxY	= _mm256_set1_epi32( m_SizeY - 1 );
+	__m256i const	sizeX	= _mm256_set1_epi32( m_SizeX );
+	float const *	pBase	= &m_Heights[ 0 ];
+
+	int	i	= 0;
+
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m256 const	u	= _mm256_add_ps( _mm256_add_ps( _mm256_div_ps( _mm256_loadu_ps( x + i ), scale ), halfX ), half );
+		__m256 const	v	= _mm256_add_ps( _mm256_add_ps( _mm256_div_ps( _mm256_loadu_ps( y + i ), scale ), halfY ), half );
+		__m256i const	tx	= _mm256_min_epi32( _mm256_max_epi32( _mm256_cvttps_epi32( u ), zero ), maxX );
+		__m256i const	ty	= _mm256_min_epi32( _mm256_max_epi32( _mm256_cvttps_epi32( v ), zero ), maxY );
+		__m256i const	j	= _mm256_add_epi32( _mm256_mullo_epi32( ty, sizeX ), tx );
+
+		_mm256_storeu_ps( heights + i, _mm256_i32gather_ps( pBase, j, 4 ) );
+	}
+
+	// Avoid the penalty for mixing AVX and SSE code in the caller
+
+	_mm256_zeroupper();
+
+	return i;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+TERRAINCACHE_TARGET_AVX2
+int TerrainCache::SampleBilinearAvx2( float const * x, float const * y, int count, float * heights ) const
+{
+	// The same computation as SampleBilinear(), 8 at a time
+
+	__m256 const	inverse	= _mm256_set1_ps( m_InverseXYScale );
+	__m256 const	maxU	= _mm256_set1_ps( m_SizeX - 1.f );
+	__m256 const	maxV	= _mm256_set1_ps( m_SizeY - 1.f );
+	__m256 const	halfX	= _mm256_set1_ps( ( m_SizeX - 1.f ) * .5f );
+	__m256 const	halfY	= _mm256_set1_ps( ( m_SizeY - 1.f ) * .5f );
+	__m256 const	zero	= _mm256_setzero_ps();
+	__m256i const	maxX	= _mm256_set1_epi32( m_SizeX - 2 );
+	__m256i const	maxY	= _mm256_set1_epi32( m_SizeY - 2 );
+	__m256i const	sizeX	= _mm256_set1_epi32( m_SizeX );
+	__m256i const	one		= _mm256_set1_epi32( 1 );
+	float const *	pBase	= &m_Heights[ 0 ];
+
+	int	i	= 0;
+
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m256	u	= _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( x + i ), inverse ), halfX );
+		__m256	v	= _mm256_add_ps( _mm256_mul_ps( _mm256_loadu_ps( y + i ), inverse ), halfY );
+
+		// max returns the second operand if the first is NaN, so NaN becomes 0, as in the scalar code
+
+		u = _mm256_min_ps( _mm256_max_ps( u, zero ), maxU );
+		v = _mm256_min_ps( _mm256_max_ps( v, zero ), maxV );
+
+		__m256i const	tx	= _mm256_min_epi32( _mm256_cvttps_epi32( u ), maxX );
+		__m256i const	ty	= _mm256_min_epi32( _mm256_cvttps_epi32( v ), maxY );
+		__m256 const	fx	= _mm256_sub_ps( u, _mm256_cvtepi32_ps( tx ) );
+		__m256 const	fy	= _mm256_sub_ps( v, _mm256_cvtepi32_ps( ty ) );
+
+		__m256i const	j00	= _mm256_add_epi32( _mm256_mullo_epi32( ty, sizeX ), tx );
+		__m256i const	j01	= _mm256_add_epi32( j00, sizeX );
+
+		__m256 const	h00	= _mm256_i32gather_ps( pBase, j00, 4 );
+		__m256 const	h10	= _mm256_i32gather_ps( pBase, _mm256_add_epi32( j00, one ), 4 );
+		__m256 const	h01	= _mm256_i32gather_ps( pBase, j01, 4 );
+		__m256 const	h11	= _mm256_i32gather_ps( pBase, _mm256_add_epi32( j01, one ), 4 );
+
+		__m256 const	h0	= _mm256_add_ps( h00, _mm256_mul_ps( _mm256_sub_ps( h10, h00 ), fx ) );
+		__m256 const	h1	= _mm256_add_ps( h01, _mm256_mul_ps( _mm256_sub_ps( h11, h01 ), fx ) );
+
+		_mm256_storeu_ps( heights + i, _mm256_add_ps( h0, _mm256_mul_ps( _mm256_sub_ps( h1, h0 ), fy ) ) );
+	}
+
+	// Avoid the penalty for mixing AVX and SSE code in the caller
+
+	_mm256_zeroupper();
+
+	return i;
+}
+
+#else // defined( TERRAINCACHE_X86 )
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int TerrainCache::SampleNearestAvx2( float const * /* x */, float const * /* y */, int /* count */,
+									 float * /* heights */ ) const
+{
+	return 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int TerrainCache::SampleBilinearAvx2( float const * /* x */, float const * /* y */, int /* count */,
+									  float * /* heights */ ) const
+{
+	return 0;
+}
+
+#endif // defined( TERRAINCACHE_X86 )
@@ -0,0 +1,96 @@
+#if !defined( TERRAINCACHE_H_INCLUDED )
+#define TERRAINCACHE_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                TerrainCache.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/TerrainCache.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include "Math/Vector3f.h"
+
+class HeightField;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// The terrain information needed by the boids, in a compact form.
+//
+// The heights of the terrain are copied into a packed array, and the result of the water test at each point is stored
+// in a bit array. The cache is rebuilt only when the terrain, its scale, or the sea level changes.
+
+class TerrainCache
+{
+public:
+
+	// How SampleHeights() finds the height at a position
+	enum Sampling
+	{
+		SAMPLE_NEAREST,		// Height of the nearest point, the same as GetHeight( GetIndex( position ) )
+		SAMPLE_BILINEAR		// Interpolated between the four surrounding points
+	};
+
+	TerrainCache();
+	virtual ~TerrainCache();
+
+	// Rebuild the cache if the terrain, scale, or sea level is different from the last time. Returns true if the
+	// cache was rebuilt.
+	bool	Refresh( HeightField const & terrain, float xyScale, float seaLevel );
+
+	// Force the next call to Refresh() to rebuild the cache (for example, after the heights have been changed)
+	void	Invalidate()								{ m_IsValid = false; }
+
+	// Return the index of the terrain point nearest to the position (the same point as used by Boid::AvoidTerrain).
+	// Positions off of the terrain use the nearest edge point.
+	int		GetIndex( Vector3f const & position ) const;
+
+	// Return the height of the terrain at a point
+	float	GetHeight( int index ) const				{ return m_Heights[ index ]; }
+
+	// Return true if the point is "over water" as determined by Boid::OverWater (the terrain is not below sea level)
+	bool	IsOverWater( int index ) const				{ return ( m_WaterMask[ index >> 5 ] & ( 1u << ( index & 31 ) ) ) != 0; }
+
+	// Find the heights of the terrain below a number of positions, given as separate arrays of x and y. Positions off
+	// of the terrain use the nearest edge. AVX2 gathers are used if NeighborKernel is using AVX2, and the results are
+	// the same either way.
+	void	SampleHeights( float const * x, float const * y, int count, float * heights, Sampling sampling ) const;
+
+	// Return the sea level that the cache was built for
+	float	GetSeaLevel() const							{ return m_SeaLevel; }
+
+private:
+
+	// Sample the heights one at a time, starting at the given index
+	void	SampleNearest( float const * x, float const * y, int begin, int count, float * heights ) const;
+	void	SampleBilinear( float const * x, float const * y, int begin, int count, float * heights ) const;
+
+	// Sample the heights 8 at a time, and return the number sampled
+	int		SampleNearestAvx2( float const * x, float const * y, int count, float * heights ) const;
+	int		SampleBilinearAvx2( float const * x, float const * y, int count, float * heights ) const;
+
+	HeightField const *				m_pTerrain;			// The terrain that the cache was built from
+	int								m_SizeX;
+	int								m_SizeY;
+	float							m_XYScale;
+	float							m_InverseXYScale;	// Used by SAMPLE_BILINEAR, which has no divide to match
+	float							m_SeaLevel;
+	bool							m_IsValid;			// False if the cache must be rebuilt
+
+	std::vector< float >			m_Heights;			// Heights of the terrain points, by row
+	std::vector< unsigned int >		m_WaterMask;		// One bit per terrain point, by row
+};
+
+
+#endif // !defined( TERRAINCACHE_H_INCLUDED )
@@ -0,0 +1,85 @@
+#if !defined( TRIPLEBUFFER_H_INCLUDED )
+#define TRIPLEBUFFER_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                 TripleBuffer.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/TripleBuffer.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <atomic>
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Three buffers shared by one producer thread and one consumer thread, neither of which ever waits for the other.
+//
+// The producer writes into the back buffer and publishes it, which exchanges it with the middle buffer. The consumer
+// takes the latest published buffer by exchanging the front buffer with the middle buffer, if it has been published
+// since the consumer last looked. The producer and the consumer never hold the same buffer, so the consumer can read
+// the front buffer for as long as it likes, and buffers published in the meantime replace each other in the middle.
+// The buffers are reused, so anything allocated in them is kept from one use to the next.
+
+template< class T >
+class TripleBuffer
+{
+public:
+
+	TripleBuffer() : m_Middle( 1 ), m_Back( 2 ), m_Front( 0 )	{}
+
+	// Return the back buffer (producer only)
+	T &			GetBack()					{ return m_Buffers[ m_Back ]; }
+
+	// Publish the back buffer and get a new one (producer only)
+	void		Publish()
+	{
+		m_Back = m_Middle.exchange( m_Back | PUBLISHED, std::memory_order_acq_rel ) & INDEX_MASK;
+	}
+
+	// Make the latest published buffer the front buffer. Returns false if nothing has been published since the last
+	// call, in which case the front buffer is unchanged (consumer only).
+	bool		Update()
+	{
+		if ( ( m_Middle.load( std::memory_order_relaxed ) & PUBLISHED ) == 0 )
+		{
+			return false;
+		}
+
+		m_Front = m_Middle.exchange( m_Front, std::memory_order_acq_rel ) & INDEX_MASK;
+		return true;
+	}
+
+	// Return the front buffer (consumer only)
+	T const &	GetFront() const			{ return m_Buffers[ m_Front ]; }
+
+private:
+
+	// Prevent copying
+	TripleBuffer( TripleBuffer const & );
+	TripleBuffer & operator =( TripleBuffer const & );
+
+	enum
+	{
+		INDEX_MASK	= 3,
+		PUBLISHED	= 4		// Set when the middle buffer has been published and not yet taken by the consumer
+	};
+
+	T					m_Buffers[ 3 ];
+	std::atomic< int >	m_Middle;		// Index of the middle buffer, and PUBLISHED
+	int					m_Back;			// Index of the back buffer (producer only)
+	int					m_Front;		// Index of the front buffer (consumer only)
+};
+
+
+#endif // !defined( TRIPLEBUFFER_H_INCLUDED )
@@ -0,0 +1,309 @@
+/*****************************************************************************
+
+                              WaterSimulation.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/WaterSimulation.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "WaterSimulation.h"
+
+#include <cassert>
+#include <cstddef>
+#include <thread>
+#include <algorithm>
+#include "WorkerPool.h"
+#include "Heightfield/Heightfield.h"
+#include "Water/Water.h"
+
+#if defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+#define WATERSIMULATION_X86
+#endif
+
+#if defined( WATERSIMULATION_X86 )
+#include <emmintrin.h>
+#endif // defined( WATERSIMULATION_X86 )
+
+// MSVC allows any intrinsics in any function. GCC and Clang must be told which functions use them.
+
+#if defined( _MSC_VER )
+#define WATERSIMULATION_TARGET_SSE2
+#else
+#define WATERSIMULATION_TARGET_SSE2	__attribute__(( target( "sse2" ) ))
+#endif
+
+namespace
+{
+
+// Number of rows handed to a thread at a time
+int const	ROWS_PER_CHUNK		= 8;
+
+// Grids with fewer rows than this are damped on the calling thread, because waking the threads costs more than it saves
+int const	MIN_ROWS_TO_SPLIT	= 128;
+
+// True if a vertex is 4 floats, starting with the height, so that 4 vertices fill 4 SSE registers
+bool const	VERTEX_IS_4_FLOATS	= sizeof( HeightField::Vertex ) == 4 * sizeof( float ) &&
+								  offsetof( HeightField::Vertex, m_Z ) == 0;
+
+#if defined( WATERSIMULATION_X86 )
+
+// Multiply the heights of the vertices [begin, end) by their factors, 4 at a time, and return the index of the first
+// vertex not done. The heights are 1 float in every 4, so each vertex is loaded whole and multiplied by its factor in
+// the first element and by 1 in the rest, which leaves the normal exactly as it was.
+
+WATERSIMULATION_TARGET_SSE2
+int DampSpanSse2( HeightField::Vertex * pRow, float const * pFactors, int begin, int end )
+{
+	__m128 const	ones	= _mm_set1_ps( 1.f );
+	int				x		= begin;
+
+	for ( ; x + 4 <= end; x += 4 )
+	{
+		float * const	p	= reinterpret_cast< float * >( pRow + x );
+		__m128 const	f	= _mm_loadu_ps( pFactors + x );
+
+		__m128 const	f0	= _mm_move_ss( ones, f );
+		__m128 const	f1	= _mm_move_ss( ones, _mm_shuffle_ps( f, f, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+		__m128 const	f2	= _mm_move_ss( ones, _mm_shuffle_ps( f, f, _MM_SHUFFLE( 2, 2, 2, 2 ) ) );
+		__m128 const	f3	= _mm_move_ss( ones, _mm_shuffle_ps( f, f, _MM_SHUFFLE( 3, 3, 3, 3 ) ) );
+
+		_mm_storeu_ps( p,		_mm_mul_ps( _mm_loadu_ps( p ), f0 ) );
+		_mm_storeu_ps( p + 4,	_mm_mul_ps( _mm_loadu_ps( p + 4 ), f1 ) );
+		_mm_storeu_ps( p + 8,	_mm_mul_ps( _mm_loadu_ps( p + 8 ), f2 ) );
+		_mm_storeu_ps( p + 12,	_mm_mul_ps( _mm_loadu_ps( p + 12 ), f3 ) );
+	}
+
+	return x;
+}
+
+#endif // defined( WATERSIMULATION_X86 )
+
+} // anonymous namespace
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Damps a range of rows on one of the threads
+
+class WaterSimulation::DampTask : public WorkerPool::Task
+{
+public:
+
+	DampTask( WaterSimulation & simulation ) : m_Simulation( simulation )	{}
+
+	virtual void Execute( int begin, int end )
+	{
+		m_Simulation.DampRows( begin, end );
+	}
+
+private:
+
+	// Prevent assignment
+	DampTask & operator =( DampTask const & );
+
+	WaterSimulation &	m_Simulation;
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+WaterSimulation::WaterSimulation( Water & water, HeightField const & terrain, int waterToLandRatio )
+	: m_Water( water ),
+	m_Terrain( terrain ),
+	m_WaterToLandRatio( waterToLandRatio ),
+	m_SeaLevel( 0. ),
+	m_FactorsAreValid( false ),
+	m_pWorkers( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+WaterSimulation::~WaterSimulation()
+{
+	delete m_pWorkers;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WaterSimulation::Update( float dt, double seaLevel )
+{
+	// The waves are stepped by the Water class, which visits every point on its own, so the damping is a second pass.
+	// It only visits the spans that need it, though.
+
+	m_Water.Update( dt );
+
+	Damp( seaLevel );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WaterSimulation::Damp( double seaLevel )
+{
+	if ( !m_FactorsAreValid || seaLevel != m_SeaLevel )
+	{
+		ComputeFactors( seaLevel );
+	}
+
+	int const	sy	= m_Water.GetSizeY();
+
+	if ( m_pWorkers && sy >= MIN_ROWS_TO_SPLIT )
+	{
+		DampTask	task( *this );
+
+		m_pWorkers->Run( task, sy, ROWS_PER_CHUNK );
+	}
+	else
+	{
+		DampRows( 0, sy );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WaterSimulation::SetThreadCount( int nThreads )
+{
+	if ( nThreads <= 0 )
+	{
+		nThreads = std::max( int( std::thread::hardware_concurrency() ), 1 );
+	}
+
+	if ( nThreads == GetThreadCount() )
+	{
+		return;
+	}
+
+	delete m_pWorkers;
+	m_pWorkers = ( nThreads > 1 ) ? new WorkerPool( nThreads ) : 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+int WaterSimulation::GetThreadCount() const
+{
+	return m_pWorkers ? m_pWorkers->GetThreadCount() : 1;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+float WaterSimulation::GetDampingFactor( int x, int y ) const
+{
+	assert( m_FactorsAreValid );
+
+	return m_Factors[ y * m_Water.GetSizeX() + x ];
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WaterSimulation::ComputeFactors( double seaLevel )
+{
+	int const		sx			= m_Water.GetSizeX();
+	int const		sy			= m_Water.GetSizeY();
+	double const	fullDepth	= seaLevel * .25;	// The waves are not damped where the water is at least this deep
+
+	m_Factors.assign( sx * sy, 1.f );
+	m_SpanBegin.assign( sy, 0 );
+	m_SpanEnd.assign( sy, 0 );
+
+	// The points on the edges are not damped
+
+	for ( int y = 1; y < sy - 1; y++ )
+	{
+		float * const	pFactors	= &m_Factors[ y * sx ];
+		int				begin		= sx;
+		int				end			= 0;
+
+		for ( int x = 1; x < sx - 1; x++ )
+		{
+			double const	depth	= seaLevel - m_Terrain.GetZ( x * m_WaterToLandRatio, y * m_WaterToLandRatio );
+			double const	factor	= std::max( 0., std::min( depth / fullDepth, 1. ) );
+
+			pFactors[ x ] = float( factor );
+
+			if ( pFactors[ x ] != 1.f )
+			{
+				begin = std::min( begin, x );
+				end = x + 1;
+			}
+		}
+
+		m_SpanBegin[ y ] = std::min( begin, end );
+		m_SpanEnd[ y ] = end;
+	}
+
+	m_SeaLevel = seaLevel;
+	m_FactorsAreValid = true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WaterSimulation::DampRows( int begin, int end )
+{
+	// Each row is only written by the thread that owns it
+
+	int const	sx	= m_Water.GetSizeX();
+
+	for ( int y = begin; y < end; y++ )
+	{
+		HeightField::Vertex * const	pRow		= m_Water.GetData() + y * sx;
+		float const * const			pFactors	= &m_Factors[ y * sx ];
+		int const					spanEnd		= m_SpanEnd[ y ];
+		int							x			= m_SpanBegin[ y ];
+
+#if defined( WATERSIMULATION_X86 )
+		if ( VERTEX_IS_4_FLOATS )
+		{
+			x = DampSpanSse2( pRow, pFactors, x, spanEnd );
+		}
+#endif // defined( WATERSIMULATION_X86 )
+
+		// The rest of the span
+
+		for ( ; x < spanEnd; x++ )
+		{
+			pRow[ x ].m_Z *= pFactors[ x ];
+		}
+	}
+}
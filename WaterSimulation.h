@@ -0,0 +1,90 @@
+#if !defined( WATERSIMULATION_H_INCLUDED )
+#define WATERSIMULATION_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                               WaterSimulation.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/WaterSimulation.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+
+class HeightField;
+class Water;
+class WorkerPool;
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// Steps the waves on the water and damps them where the water is shallow.
+//
+// The waves at a point of the water (other than at the edges) are scaled by depth / ( seaLevel / 4 ), clamped to
+// [0, 1], where depth is the depth of the water at the matching point of the terrain. The factors only depend on the
+// terrain and the sea level, so they are computed once for each sea level. Each row is only damped over the span
+// of points whose factors are not 1, which is usually the shore and the land. On x86, the span is damped 4 points at
+// a time. The rows can be split across threads, but small grids are damped on the calling thread.
+
+class WaterSimulation
+{
+public:
+
+	// The terrain has waterToLandRatio points for each point of the water in each direction
+	WaterSimulation( Water & water, HeightField const & terrain, int waterToLandRatio );
+	virtual ~WaterSimulation();
+
+	// Step the waves by dt seconds and then damp them
+	void	Update( float dt, double seaLevel );
+
+	// Damp the waves without stepping them
+	void	Damp( double seaLevel );
+
+	// Set the number of threads that damp the rows. 0 means one per hardware thread. The default is 1.
+	void	SetThreadCount( int nThreads );
+
+	// Return the number of threads that damp the rows
+	int		GetThreadCount() const;
+
+	// The damping factors are recomputed when the sea level changes. Call this after changing the heights of the terrain.
+	void	InvalidateTerrain()							{ m_FactorsAreValid = false; }
+
+	// Return the damping factor of a point of the water, for the sea level of the last update
+	float	GetDampingFactor( int x, int y ) const;
+
+private:
+
+	class DampTask;
+
+	// Prevent copying
+	WaterSimulation( WaterSimulation const & );
+	WaterSimulation & operator =( WaterSimulation const & );
+
+	// Compute the damping factors for the sea level
+	void	ComputeFactors( double seaLevel );
+
+	// Damp the spans of the rows [begin, end)
+	void	DampRows( int begin, int end );
+
+	Water &					m_Water;
+	HeightField const &		m_Terrain;
+	int						m_WaterToLandRatio;
+	std::vector< float >	m_Factors;			// Damping factor of each point of the water
+	std::vector< int >		m_SpanBegin;		// First point in each row whose factor is not 1
+	std::vector< int >		m_SpanEnd;			// One past the last point in each row whose factor is not 1
+	double					m_SeaLevel;			// Sea level of the factors
+	bool					m_FactorsAreValid;
+	WorkerPool *			m_pWorkers;			// Threads that damp the rows, or 0 if there is only one
+};
+
+
+#endif // !defined( WATERSIMULATION_H_INCLUDED )
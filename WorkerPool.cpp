@@ -0,0 +1,199 @@
+/*****************************************************************************
+
+                                WorkerPool.cpp
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/WorkerPool.cpp#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include "WorkerPool.h"
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+WorkerPool::WorkerPool( int nThreads )
+	: m_ThreadCount( std::max( nThreads, 1 ) ),
+	m_pShares( 0 ),
+	m_Generation( 0 ),
+	m_Busy( 0 ),
+	m_Quit( false ),
+	m_pTask( 0 ),
+	m_Count( 0 ),
+	m_ChunkSize( 1 )
+{
+	m_pShares = new Share[ m_ThreadCount ];
+
+	for ( int i = 0; i < m_ThreadCount; i++ )
+	{
+		m_pShares[ i ].m_Next = 0;
+		m_pShares[ i ].m_End = 0;
+	}
+
+	m_Threads.reserve( m_ThreadCount - 1 );
+	for ( int i = 1; i < m_ThreadCount; i++ )
+	{
+		m_Threads.push_back( std::thread( &WorkerPool::WorkerMain, this, i ) );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard< std::mutex >	lock( m_Mutex );
+		m_Quit = true;
+	}
+	m_Started.notify_all();
+
+	for ( std::vector< std::thread >::iterator pT = m_Threads.begin(); pT != m_Threads.end(); ++pT )
+	{
+		pT->join();
+	}
+
+	delete[] m_pShares;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WorkerPool::Run( Task & task, int count, int chunkSize )
+{
+	if ( count <= 0 )
+	{
+		return;
+	}
+
+	chunkSize = std::max( chunkSize, 1 );
+
+	// If there is only one thread or one chunk, then there is nothing to share
+
+	int const	nChunks	= ( count + chunkSize - 1 ) / chunkSize;
+
+	if ( m_ThreadCount == 1 || nChunks == 1 )
+	{
+		task.Execute( 0, count );
+		return;
+	}
+
+	// Divide the chunks evenly between the threads and start the created threads
+
+	{
+		std::lock_guard< std::mutex >	lock( m_Mutex );
+
+		for ( int i = 0; i < m_ThreadCount; i++ )
+		{
+			m_pShares[ i ].m_Next.store( int( ( long long )nChunks * i / m_ThreadCount ), std::memory_order_relaxed );
+			m_pShares[ i ].m_End = int( ( long long )nChunks * ( i + 1 ) / m_ThreadCount );
+		}
+
+		m_pTask		= &task;
+		m_Count		= count;
+		m_ChunkSize	= chunkSize;
+		m_Busy		= m_ThreadCount - 1;
+		++m_Generation;
+	}
+	m_Started.notify_all();
+
+	// Help out
+
+	Work( 0 );
+
+	// Wait for the others to finish
+
+	std::unique_lock< std::mutex >	lock( m_Mutex );
+	while ( m_Busy > 0 )
+	{
+		m_Finished.wait( lock );
+	}
+	m_pTask = 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WorkerPool::WorkerMain( int self )
+{
+	unsigned int	generation	= 0;
+
+	for ( ;; )
+	{
+		// Wait for work
+
+		{
+			std::unique_lock< std::mutex >	lock( m_Mutex );
+			while ( !m_Quit && m_Generation == generation )
+			{
+				m_Started.wait( lock );
+			}
+
+			if ( m_Quit )
+			{
+				return;
+			}
+
+			generation = m_Generation;
+		}
+
+		Work( self );
+
+		// Report that this thread is done
+
+		{
+			std::lock_guard< std::mutex >	lock( m_Mutex );
+			--m_Busy;
+			if ( m_Busy == 0 )
+			{
+				m_Finished.notify_one();
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WorkerPool::Work( int self )
+{
+	// Start with this thread's own share and then visit the others in turn
+
+	for ( int i = 0; i < m_ThreadCount; i++ )
+	{
+		Share &	share	= m_pShares[ ( self + i ) % m_ThreadCount ];
+
+		for ( int chunk = share.m_Next.fetch_add( 1 ); chunk < share.m_End; chunk = share.m_Next.fetch_add( 1 ) )
+		{
+			int const	begin	= chunk * m_ChunkSize;
+			int const	end		= std::min( begin + m_ChunkSize, m_Count );
+
+			m_pTask->Execute( begin, end );
+		}
+	}
+}
@@ -0,0 +1,96 @@
+#if !defined( WORKERPOOL_H_INCLUDED )
+#define WORKERPOOL_H_INCLUDED
+
+#pragma once
+
+/*****************************************************************************
+
+                                 WorkerPool.h
+
+						Copyright 2001, John J. Bolton
+	----------------------------------------------------------------------
+
+	$Header: //depot/Flock/WorkerPool.h#1 $
+
+	$NoKeywords: $
+
+*****************************************************************************/
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+// A set of persistent threads that work together on a range of items.
+//
+// The range is divided into chunks, and each thread starts with an equal share of the chunks. A thread that finishes
+// its share takes chunks from the shares of the other threads until there are none left.
+
+class WorkerPool
+{
+public:
+
+	// Work to be done on a range of items
+	class Task
+	{
+	public:
+		virtual ~Task() {}
+
+		// Process the items in the range [begin, end)
+		virtual void	Execute( int begin, int end ) = 0;
+	};
+
+	// The calling thread participates in the work, so nThreads - 1 threads are created
+	WorkerPool( int nThreads );
+	virtual ~WorkerPool();
+
+	// Return the number of threads that do the work, including the calling thread
+	int		GetThreadCount() const		{ return m_ThreadCount; }
+
+	// Run the task on the items [0, count) in chunks of chunkSize, and return when all items have been processed
+	void	Run( Task & task, int count, int chunkSize );
+
+private:
+
+	// Prevent copying
+	WorkerPool( WorkerPool const & );
+	WorkerPool & operator =( WorkerPool const & );
+
+	// The chunks that have not been taken from a thread's share
+	struct Share
+	{
+		std::atomic< int >	m_Next;			// Next chunk
+		int					m_End;			// One past the last chunk
+		char				m_Pad[ 64 ];	// Keep the shares in separate cache lines
+	};
+
+	// Thread function for the created threads
+	void	WorkerMain( int self );
+
+	// Do the chunks in the thread's own share and then the chunks remaining in the other shares
+	void	Work( int self );
+
+	int							m_ThreadCount;
+	std::vector< std::thread >	m_Threads;
+	Share *						m_pShares;
+
+	std::mutex					m_Mutex;
+	std::condition_variable		m_Started;		// Signaled when there is new work (or the pool is shutting down)
+	std::condition_variable		m_Finished;		// Signaled when the last worker is done
+	unsigned int				m_Generation;	// Incremented for each call to Run()
+	int							m_Busy;			// Number of created threads that are still working
+	bool						m_Quit;			// True if the threads should exit
+
+	Task *						m_pTask;
+	int							m_Count;
+	int							m_ChunkSize;
+};
+
+
+#endif // !defined( WORKERPOOL_H_INCLUDED )
@@ -13,8 +13,13 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <sstream>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -37,15 +42,29 @@
 #include "Math/Constants.h"
 #include "TgaFile/TgaFile.h"
 #include "TerrainCamera/TerrainCamera.h"
-#include "HeightField/HeightField.h"
+#include "Heightfield/Heightfield.h"
 #include "Water/Water.h"
 
 #include "Flock.h"
+#include "FlockScheduler.h"
+#include "ChromeTrace.h"
+#include "WaterSimulation.h"
+#include "HeightFieldMesh.h"
+#include "FlockInstances.h"
+#include "FramePipeline.h"
+#include "TripleBuffer.h"
+#include "BoidArrays.h"
+#include "BoidCulling.h"
+#include "Frustum.h"
 
 int const	WATER_TO_LAND_RATIO	= 4;
 float const	XY_SCALE			= 1.f;
 float const	Z_SCALE				= 32.f;
 int const	FLOCK_SIZE			= 100;
+float const	FLOCK_STEP_RATE		= 60.f;		// Flock updates per second
+int const	FLOCK_MAX_STEPS		= 4;		// Maximum flock updates per frame
+float const	BOID_RADIUS			= 1.1f;		// Radius of a sphere around the boid mesh
+float const	BOID_DRAW_DISTANCE	= 500.f;	// Boids farther away than this are not drawn
 
 static LRESULT CALLBACK WindowProc( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam );
 static void InitializeRendering();
@@ -53,14 +72,32 @@ static void Display();
 static void Reshape( int w, int h );
 static void Update( HWND hWnd );
 static void ReportGlErrors( GLenum error );
-static void UpdateWater( DWORD newTime );
-static void DrawWater();
+static void UpdateWater( float dt, double seaLevel );
+static void AddRipple();
+static void DrawWater( FrameSnapshot const & snapshot );
 static void DrawTerrain();
 
-static void UpdateFlock( DWORD newTime );
-static void DrawFlock();
+static void UpdateFlock( float dt, double seaLevel );
+static void DrawFlock( FrameSnapshot const & snapshot );
 static void DrawBoid();
 
+
+// Runs the water and the flock on the simulation thread (see FramePipeline)
+
+class WorldSimulation : public FramePipeline::Simulation
+{
+public:
+
+	WorldSimulation() : m_SeaLevel( 0. )	{}
+
+	virtual bool	Step( float elapsed );
+	virtual void	Capture( FrameSnapshot & snapshot );
+
+private:
+
+	double	m_SeaLevel;		// Sea level of the last step
+};
+
 static char						s_AppName[]	 = "Flock";
 static char						s_TitleBar[] = "Flock";
 
@@ -78,14 +115,24 @@ static Glx::Material *			s_pBoidMaterial;
 
 static TerrainCamera *			s_pCamera;
 static Water *					s_pWater;
+static WaterSimulation *		s_pWaterSimulation;
+static HeightFieldMesh			s_TerrainGeometry;
 static HeightField *			s_pTerrain;
 static float					s_CameraSpeed				= 2.f;
-static double					s_SeaLevel					= Z_SCALE * .25;
+static std::atomic< double >	s_SeaLevel( Z_SCALE * .25 );	// Set by the user, used by the simulation thread
+static std::atomic< int >		s_PendingRipples( 0 );			// Ripples to be added by the simulation thread
 
 static RandomFloat				s_RandomFloat( timeGetTime() );
 static Random					s_Random( timeGetTime() );
 
 static Flock					s_Flock;
+static FlockScheduler			s_FlockScheduler( s_Flock, FLOCK_STEP_RATE, FLOCK_MAX_STEPS );
+static TripleBuffer< Frustum >	s_Views;			// The views drawn, for culling on the simulation thread
+static BoidArrays				s_DrawnBoids;		// The visible boids at the time of the frame being drawn
+static FlockInstances			s_BoidInstances;	// The transforms of the visible boids
+
+static WorldSimulation			s_Simulation;
+static FramePipeline			s_Pipeline( s_Simulation, 1.f / FLOCK_STEP_RATE );
 
 static inline int WSizeX()
 {
@@ -155,6 +202,11 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPreviousInst, LPSTR lpszCmdL
 	}
 
 	s_pWater = new Water( WSizeX(), WSizeY(), WATER_TO_LAND_RATIO * XY_SCALE, 20.f, .99f );
+	s_pWaterSimulation = new WaterSimulation( *s_pWater, *s_pTerrain, WATER_TO_LAND_RATIO );
+
+	// Build the vertex and index arrays for the terrain. The water's are in the snapshots made by the simulation.
+
+	s_TerrainGeometry.Build( *s_pTerrain, XY_SCALE, .125f );
 
 	// Generate the flock
 
@@ -168,10 +220,7 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPreviousInst, LPSTR lpszCmdL
 								  s_RandomFloat.Next( -1.f, 1.f ) * Boid::DESIRED_SPEED,
 								  s_RandomFloat.Next( -.1f, .1f ) * Boid::DESIRED_SPEED );
 
-		Boid * const	pBoid	= new Boid( position, velocity );
-		if ( !pBoid ) throw std::bad_alloc();
-
-		s_Flock.push_back( pBoid );
+		s_Flock.Add( position, velocity );
 	}
 
 	HDC const	hDC	= GetDC( hWnd );
@@ -262,8 +311,23 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPreviousInst, LPSTR lpszCmdL
 
 		ShowWindow( hWnd, nCmdShow );
 
+		// "-trace" on the command line records a timeline of the frames (see ChromeTrace)
+
+		if ( lpszCmdLine && strstr( lpszCmdLine, "-trace" ) )
+		{
+			ChromeTrace::Start( "flock.trace.json" );
+		}
+
+		// The water and the flock are simulated on their own thread from here on, and drawn from its snapshots
+
+		s_Pipeline.Start();
+
 		rv = Wx::MessageLoop( hWnd, Update );
 
+		s_Pipeline.Stop();
+
+		ChromeTrace::Stop();
+
 		delete s_pBoidMesh;
 		delete s_pBoidMaterial;
 		delete s_pTerrainMesh;
@@ -274,10 +338,7 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPreviousInst, LPSTR lpszCmdL
 		delete s_pLighting;
 		delete s_pCamera;
 
-		for ( Flock::iterator ppB = s_Flock.begin(); ppB != s_Flock.end(); ++ppB )
-		{
-			delete *ppB;
-		}
+		// The boids are freed by the flock
 	}
 
 	ReleaseDC( hWnd, hDC );
@@ -294,15 +355,100 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE hPreviousInst, LPSTR lpszCmdL
 
 static void Update( HWND hWnd )
 {
-	DWORD const	newTime	= timeGetTime();
-
-	UpdateWater( newTime );
-	UpdateFlock( newTime );
+	// The simulation runs on its own thread, so there is only drawing to do here
 
 	InvalidateRect( hWnd, NULL, FALSE );
 }
 
 
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+bool WorldSimulation::Step( float elapsed )
+{
+	m_SeaLevel = s_SeaLevel.load();
+
+	for ( int n = s_PendingRipples.exchange( 0 ); n > 0; n-- )
+	{
+		AddRipple();
+	}
+
+	{
+		ChromeTrace::Scope const	trace( "water update" );
+
+		UpdateWater( elapsed, m_SeaLevel );
+	}
+
+	{
+		ChromeTrace::Scope const	trace( "flock update" );
+
+		UpdateFlock( elapsed, m_SeaLevel );
+	}
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
+
+void WorldSimulation::Capture( FrameSnapshot & snapshot )
+{
+	// The boids are saved before and after the last flock update, and the renderer draws them part way between, at
+	// the time of its frame. A boid that wrapped around the edge of the terrain or was added by the update is where it
+	// is now in both.
+
+	int const	n			= s_Flock.GetCount();
+	float		maxMove		= 0.f;
+
+	snapshot.m_PreviousBoids.Resize( n );
+	snapshot.m_CurrentBoids.Resize( n );
+
+	for ( int id = 0; id < n; id++ )
+	{
+		Vector3f const	previous	= s_FlockScheduler.GetInterpolatedPosition( id, 0.f );
+		Vector3f const	current		= s_Flock.GetPosition( id );
+		Vector3f const	velocity	= s_Flock.GetVelocity( id );
+
+		snapshot.m_PreviousBoids.SetPosition( id, previous );
+		snapshot.m_PreviousBoids.SetVelocity( id, velocity );
+		snapshot.m_CurrentBoids.SetPosition( id, current );
+		snapshot.m_CurrentBoids.SetVelocity( id, velocity );
+
+		maxMove = std::max( maxMove, ( current - previous ).Length() );
+	}
+
+	snapshot.m_StepTime	= s_FlockScheduler.GetStepTime();
+	snapshot.m_Alpha	= s_FlockScheduler.GetAlpha();
+
+	// The boids are culled here, with the flock's grid, against the latest view drawn. A boid can be drawn anywhere
+	// between its two positions, so its sphere is grown by the farthest that any boid moved. The view is a frame
+	// behind the renderer, so a boid at the edge of the view can appear a frame late when the camera turns.
+
+	s_Views.Update();
+
+	BoidCulling::Cull( s_Flock, snapshot.m_CurrentBoids, s_Views.GetFront(), BOID_RADIUS + maxMove, 0.f,
+					   snapshot.m_VisibleBoids );
+
+	// Only the heights and normals of the water change, so the rest of the mesh is built once for each snapshot
+
+	if ( snapshot.m_Water.GetVertexCount() == 0 )
+	{
+		snapshot.m_Water.Build( *s_pWater, s_pWater->GetXYScale(), .125f );
+	}
+	else
+	{
+		snapshot.m_Water.UpdateHeights( *s_pWater );
+	}
+
+	snapshot.m_SeaLevel = m_SeaLevel;
+}
+
+
 /********************************************************************************************************************/
 /*																													*/
 /*																													*/
@@ -316,7 +462,11 @@ static LRESULT CALLBACK WindowProc( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 	{
 		static PAINTSTRUCT ps;
 
-		Display();
+		{
+			ChromeTrace::Scope const	trace( "draw" );
+
+			Display();
+		}
 		BeginPaint( hWnd, &ps );
 		EndPaint( hWnd, &ps );
 		return 0;
@@ -360,13 +510,13 @@ static LRESULT CALLBACK WindowProc( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 			break;
 
 		case '1':
-			s_SeaLevel -= Z_SCALE * .01;
-			trace( "Sea level = %f\n", s_SeaLevel );
+			s_SeaLevel = s_SeaLevel - Z_SCALE * .01;
+			trace( "Sea level = %f\n", s_SeaLevel.load() );
 			break;
 
 		case '2':
-			s_SeaLevel += Z_SCALE * .01;
-			trace( "Sea level = %f\n", s_SeaLevel );
+			s_SeaLevel = s_SeaLevel + Z_SCALE * .01;
+			trace( "Sea level = %f\n", s_SeaLevel.load() );
 			break;
 		}
 
@@ -403,21 +553,8 @@ static LRESULT CALLBACK WindowProc( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM
 		return 0;
 
 	case WM_TIMER:
-		{
-			int const		RADIUS	=	3;
-			float const		H		= Z_SCALE *.125f;
-			float const		L		= 8.f;
-			int	const		x0		= s_Random.Next( RADIUS, s_pWater->GetSizeX() - RADIUS );
-			int const		y0		= s_Random.Next( RADIUS, s_pWater->GetSizeY() - RADIUS );
-
-			for ( int i = -(RADIUS-1); i < RADIUS; i++ )
-			{
-				for ( int j = -(RADIUS-1); j < RADIUS; j++ )
-				{
-					s_pWater->GetData( x0+j, y0+i )->m_Z = H * cos( Math::TWO_PI * sqrt( i*i + j*j ) / L );
-				}
-			}
-		}
+		// The water belongs to the simulation thread, so it adds the ripple
+		++s_PendingRipples;
 		return 0;
 
 	case WM_CLOSE:
@@ -449,34 +586,34 @@ static void InitializeRendering()
 /*																													*/
 /********************************************************************************************************************/
 
-static void UpdateWater( DWORD newTime )
+static void UpdateWater( float dt, double seaLevel )
 {
-	static DWORD	oldTime	= timeGetTime();
+	// Compute the new heights and apply a damping factor due to land
 
-	// Compute the new heights
+	s_pWaterSimulation->Update( dt, seaLevel );
+}
 
-	s_pWater->Update( ( newTime - oldTime ) * .001f );
 
-	// Apply a damping factor due to land
+/********************************************************************************************************************/
+/*																													*/
+/*																													*/
+/********************************************************************************************************************/
 
-	int const					sx		= s_pWater->GetSizeX();
-	int const					sy		= s_pWater->GetSizeY();
+static void AddRipple()
+{
+	int const		RADIUS	=	3;
+	float const		H		= Z_SCALE *.125f;
+	float const		L		= 8.f;
+	int	const		x0		= s_Random.Next( RADIUS, s_pWater->GetSizeX() - RADIUS );
+	int const		y0		= s_Random.Next( RADIUS, s_pWater->GetSizeY() - RADIUS );
 
-	for ( int y = 1; y < sy - 1; y++ )
+	for ( int i = -(RADIUS-1); i < RADIUS; i++ )
 	{
-		for ( int x = 1; x < sx - 1; x++ )
+		for ( int j = -(RADIUS-1); j < RADIUS; j++ )
 		{
-			int const					wx		= W2T( x );
-			int const					wy		= W2T( y );
-			double const				depth	= ( s_SeaLevel - s_pTerrain->GetZ( wx, wy ) );
-
-			s_pWater->GetData( x, y )->m_Z	*= limit( 0., depth / ( s_SeaLevel * .25 ), 1. );
+			s_pWater->GetData( x0+j, y0+i )->m_Z = H * cos( Math::TWO_PI * sqrt( i*i + j*j ) / L );
 		}
 	}
-
-	// Save the new time
-
-	oldTime = newTime;
 }
 
 
@@ -485,69 +622,26 @@ static void UpdateWater( DWORD newTime )
 /*																													*/
 /********************************************************************************************************************/
 
-static void DrawWater()
+static void DrawWater( FrameSnapshot const & snapshot )
 {
-	glPushMatrix();
+	HeightFieldMesh const &	water	= snapshot.m_Water;
 
-	int const					sx		= s_pWater->GetSizeX();
-	int const					sy		= s_pWater->GetSizeY();
-	float const					d		= s_pWater->GetXYScale();
-	HeightField::Vertex const *	pData	= s_pWater->GetData();
-	float const					x0		= -( sx - 1 ) * .5f * d;
-	float const					y0		= -( sy - 1 ) * .5f * d;
+	glPushMatrix();
 
 	glEnable( GL_BLEND );
 	glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
 	s_pWaterMaterial->Apply();
 
-	glEnableClientState( GL_NORMAL_ARRAY );
-	glNormalPointer( GL_FLOAT, sizeof( HeightField::Vertex ), &pData->m_Normal );
-
 	// Raise the water to sealevel
 
-	glTranslatef( 0.f, 0.f, s_SeaLevel );
-
-	for ( int i = 0; i < sy-1; i += 1 )
-	{
-		glBegin( GL_TRIANGLE_STRIP );
-
-		for ( int j = 0; j < sx; j += 1 )
-		{
-			float const	x	= x0 + j * d;
-			float const	tx	= float( j ) * .125f;//float( j ) / float( sx - 1 );
-
-			HeightField::Vertex const * const	pa	= &pData[ i * sx + j ];
-			HeightField::Vertex const * const	pb	= pa + sx;
-
-			float const	yb	= y0 + ( i + 1 ) * d;
-			float const	tyb	= float( i + 1 ) * .125f;//float( i + 1 ) / float( sy - 1 );
-			float const	zb	= pb->m_Z;
+	glTranslatef( 0.f, 0.f, snapshot.m_SeaLevel );
 
-#if defined( USING_WATER_TEXTURE )
-			glTexCoord2f( tx, tyb );
-#endif // defined( USING_WATER_TEXTURE )
-
-			glArrayElement( ( i + 1 ) * sx + j );
-//			glNormal3fv( pb->m_Normal.m_V );
-			glVertex3f( x, yb, zb );
-
-			float const	ya	= y0 + i * d;
-			float const	tya	= float( i ) * .125f;//float( i ) / float( sy - 1 );
-			float const	za	= pa->m_Z;
-
-#if defined( USING_WATER_TEXTURE )
-			glTexCoord2f( tx, tya );
-#endif // defined( USING_WATER_TEXTURE )
-
-			glArrayElement( i * sx + j );
-//			glNormal3fv( pa->m_Normal.m_V );
-			glVertex3f( x, ya, za );
-		}
-
-		glEnd();
-	}
+	glInterleavedArrays( GL_T2F_N3F_V3F, 0, water.GetVertices() );
+	glDrawElements( GL_TRIANGLES, water.GetIndexCount(), GL_UNSIGNED_INT, water.GetIndices() );
 
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
 	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
 	glDisable( GL_BLEND );
 
 	glPopMatrix();
@@ -562,52 +656,14 @@ static void DrawWater()
 
 static void DrawTerrain()
 {
-	int const					sx		= s_pTerrain->GetSizeX();
-	int const					sy		= s_pTerrain->GetSizeY();
-	HeightField::Vertex const *	pData	= s_pTerrain->GetData();
-	float const					x0		= -( sx - 1 ) * .5f * XY_SCALE;
-	float const					y0		= -( sy - 1 ) * .5f * XY_SCALE;
-
 	s_pTerrainMaterial->Apply();
 
-	glEnableClientState( GL_NORMAL_ARRAY );
-	glNormalPointer( GL_FLOAT, sizeof( HeightField::Vertex ), &s_pTerrain->GetData()->m_Normal );
-
-	for ( int i = 0; i < sy-1; i += 1 )
-	{
-		glBegin( GL_TRIANGLE_STRIP );
-
-		for ( int j = 0; j < sx; j += 1 )
-		{
-			float const	x	= x0 + j * XY_SCALE;
-			float const	tx	= float( j ) * .125f;//float( j ) / float( sx - 1 );
-
-			HeightField::Vertex const * const	pa	= &pData[ i * sx + j ];
-			HeightField::Vertex const * const	pb	= pa + sx;
-
-			float const	yb	= y0 + ( i + 1 ) * XY_SCALE;
-			float const	tyb	= float( i + 1 ) * .125f;//float( i + 1 ) / float( sy - 1 );
-			float const	zb	= pb->m_Z;
-
-			glTexCoord2f( tx, tyb );
-			glArrayElement( ( i + 1 ) * sx + j );
-//			glNormal3fv( pb->m_Normal.m_V );
-			glVertex3f( x, yb, zb );
-
-			float const	ya	= y0 + i * XY_SCALE;
-			float const	tya	= float( i ) * .125f;//float( i ) / float( sy - 1 );
-			float const	za	= pa->m_Z;
-
-			glTexCoord2f( tx, tya );
-			glArrayElement( i * sx + j );
-//			glNormal3fv( pa->m_Normal.m_V );
-			glVertex3f( x, ya, za );
-		}
-
-		glEnd();
-	}
+	glInterleavedArrays( GL_T2F_N3F_V3F, 0, s_TerrainGeometry.GetVertices() );
+	glDrawElements( GL_TRIANGLES, s_TerrainGeometry.GetIndexCount(), GL_UNSIGNED_INT, s_TerrainGeometry.GetIndices() );
 
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );
 	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_VERTEX_ARRAY );
 }
 
 
@@ -616,17 +672,14 @@ static void DrawTerrain()
 /*																													*/
 /********************************************************************************************************************/
 
-static void UpdateFlock( DWORD newTime )
+static void UpdateFlock( float dt, double seaLevel )
 {
-	static DWORD	oldTime	= timeGetTime();
-	int const		dt		= int( newTime - oldTime );
-
-	if ( dt <= 0 )
+	if ( dt <= 0.f )
 		return;
 
-	s_Flock.Update( dt * .001f, *s_pTerrain, XY_SCALE, s_SeaLevel );
+	// The flock is stepped at a fixed rate, regardless of the frame rate
 
-	oldTime = newTime;
+	s_FlockScheduler.Advance( dt, *s_pTerrain, XY_SCALE, float( seaLevel ) );
 }
 
 
@@ -635,15 +688,53 @@ static void UpdateFlock( DWORD newTime )
 /*																													*/
 /********************************************************************************************************************/
 
-static void DrawFlock()
+static void DrawFlock( FrameSnapshot const & snapshot )
 {
-	for ( Flock::iterator ppB = s_Flock.begin(); ppB != s_Flock.end(); ++ppB )
+	// The view is handed to the simulation thread, which culls the boids for the snapshots that follow
+
+	float	projection[ 16 ];
+	float	view[ 16 ];
+
+	glGetFloatv( GL_PROJECTION_MATRIX, projection );
+	glGetFloatv( GL_MODELVIEW_MATRIX, view );
+
+	Frustum &	frustum	= s_Views.GetBack();
+
+	frustum.Set( projection, view );
+	frustum.SetMaxDistance( BOID_DRAW_DISTANCE );
+	s_Views.Publish();
+
+	// The visible boids are drawn part way between the last two flock updates, at the time of this frame. The time
+	// since the snapshot was made is added to the part of a step that had passed then.
+
+	float const	age		= std::chrono::duration< float >( std::chrono::steady_clock::now() - snapshot.m_Time ).count();
+	float const	alpha	= std::min( snapshot.m_Alpha + age / snapshot.m_StepTime, 1.f );
+
+	std::vector< int > const &	visible	= snapshot.m_VisibleBoids;
+	int const					count	= int( visible.size() );
+
+	s_DrawnBoids.Resize( count );
+
+	for ( int i = 0; i < count; i++ )
 	{
-		Boid const &	boid	= **ppB;
+		Vector3f const	previous	= snapshot.m_PreviousBoids.GetPosition( visible[ i ] );
+		Vector3f const	current		= snapshot.m_CurrentBoids.GetPosition( visible[ i ] );
+
+		s_DrawnBoids.SetPosition( i, previous + ( current - previous ) * alpha );
+		s_DrawnBoids.SetVelocity( i, snapshot.m_CurrentBoids.GetVelocity( visible[ i ] ) );
+	}
+
+	// Each boid is turned to face the way it is flying
+
+	s_BoidInstances.Pack( s_DrawnBoids );
 
+	FlockInstances::Instance const * const	pInstances	= s_BoidInstances.GetInstances();
+
+	for ( int i = 0; i < count; i++ )
+	{
 		glPushMatrix();
 
-		glTranslatef( boid.m_Position.m_X, boid.m_Position.m_Y, boid.m_Position.m_Z );
+		glMultMatrixf( pInstances[ i ].m_Matrix );
 
 		s_pBoidMesh->Apply();
 
@@ -703,9 +794,16 @@ static void Display()
 
 	s_pDirectionalLight->Apply();
 
+	// Draw the latest state of the simulation. Nothing is drawn but the terrain until the first one is ready.
+
+	FrameSnapshot const * const	pSnapshot	= s_Pipeline.Acquire();
+
 	// Draw the flock
 
-	DrawFlock();
+	if ( pSnapshot )
+	{
+		DrawFlock( *pSnapshot );
+	}
 
 	// Draw the terrain
 
@@ -713,7 +811,10 @@ static void Display()
 
 	// Draw the water
 
-	DrawWater();
+	if ( pSnapshot )
+	{
+		DrawWater( *pSnapshot );
+	}
 
 	// Display the scene
 